@@ -0,0 +1,38 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+/*****************************************************************************
+ * Block-Size Autotuner (-b auto)
+ *
+ * The first run for a (method, element type, rows, cols, threads, in-place,
+ * CPU model) key
+ * times a short sweep over block sizes and register-tile kernels and stores
+ * the winner in a JSON tuning file; later runs just read it back. The file is
+ * $MATTRANSPOSE_TUNE_FILE if set, else $XDG_CACHE_HOME/mattranspose/tune.json,
+ * else ~/.cache/mattranspose/tune.json.
+ *****************************************************************************/
+
+typedef struct {
+    int    blockSize;       // matTransposeBlock* / matTransposeOMP* / in-place kernels
+    int    checkBlockSize;  // checkSymBlock / checkSymOMP
+    char   kernel[16];      // register-tile kernel, see setTransposeKernel
+    double seconds;         // best transpose time seen during the sweep
+    int    fromCache;       // 1 if the result was read from the tuning file
+} TuneResult;
+
+// Methods whose kernels take a block size: serialblock and omp.
+int autotuneSupported(const char *method);
+
+/**
+ * @brief Looks up or measures the best block sizes and tile kernel for
+ *        'method' and leaves that kernel selected.
+ *
+ * matrix  rows x cols input (left unchanged).
+ * scratch rows x cols buffer the sweep may overwrite, or NULL in in-place
+ *         mode; then the in-place kernels are timed on 'matrix' in pairs so
+ *         it ends up unchanged, and checkBlockSize falls back to blockSize.
+ */
+void autotune(const char *method, int inPlace, void *matrix, void *scratch,
+              int rows, int cols, TuneResult *result);
+
+#endif // AUTOTUNE_H
@@ -0,0 +1,68 @@
+#ifndef MATRIX_ALLOC_H
+#define MATRIX_ALLOC_H
+
+#include <stddef.h>
+
+/*****************************************************************************
+ * Matrix Allocation (--hugepages, --alloc-report)
+ *
+ * Every matrix, slab and communication buffer of the transpose methods
+ * comes from matrixAlloc, so every base address is MATRIX_ALIGN (64) byte
+ * aligned: a cache line, and one full AVX-512 register. A row or tile inside
+ * a matrix is only aligned when its offset is, e.g. when the row length in
+ * bytes is a multiple of 64.
+ *
+ * A column walk touches a new page every step, so with 4 KiB pages the big
+ * transposes are bound by TLB misses. Buffers of at least one huge page are
+ * therefore mmap'ed on their own, huge page aligned, and backed according
+ * to the mode:
+ *
+ *   thp      madvise(MADV_HUGEPAGE): the kernel backs the range with
+ *            transparent huge pages when it can (default)
+ *   hugetlb  MAP_HUGETLB from the reserved pool (vm.nr_hugepages); falls back
+ *            to thp when the pool is empty or missing
+ *   off      madvise(MADV_NOHUGEPAGE): 4 KiB pages, the baseline
+ *
+ * Smaller buffers come from posix_memalign. Any failure along the way falls
+ * back to the next option, so huge pages are only ever a hint.
+ *
+ * Not thread-safe: allocate and free from the master thread, like MPI.
+ *****************************************************************************/
+
+#define MATRIX_ALIGN 64
+
+// Returns 0 for an unknown mode ("thp", "hugetlb" or "off").
+int  setHugePages(const char *mode);
+const char *hugePagesName(void);
+
+/**
+ * @brief 'bytes' of uninitialized memory aligned to MATRIX_ALIGN, or NULL
+ *        like malloc. 'label' (a string literal) names the buffer in the
+ *        allocation report.
+ */
+void *matrixAlloc(size_t bytes, const char *label);
+
+// matrixAlloc, zeroed.
+void *matrixCalloc(size_t count, size_t size, const char *label);
+
+// Releases a matrixAlloc / matrixCalloc buffer; plain free for anything else.
+void  matrixFree(void *ptr);
+
+/**
+ * @brief With the report enabled every huge-page-sized buffer is checked in
+ *        /proc/self/smaps for the huge pages actually backing it, when it
+ *        is freed (which adds one read of smaps to that free) or reported.
+ */
+void  setAllocReport(int enabled);
+int   allocReportEnabled(void);
+
+/**
+ * @brief Prints the buffers this process allocated, per label: count,
+ *        bytes, how they were backed and the share on huge pages.
+ */
+void  matrixAllocReport(void);
+
+// Bytes allocated so far and how many of them sat on huge pages.
+void  matrixAllocTotals(size_t *bytes, size_t *hugeBytes);
+
+#endif // MATRIX_ALLOC_H
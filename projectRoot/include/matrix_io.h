@@ -0,0 +1,86 @@
+#ifndef MATRIX_IO_H
+#define MATRIX_IO_H
+
+#include <stdint.h>
+
+/*****************************************************************************
+ * Binary Matrix Files (--input, --output, --format)
+ *
+ * A 64-byte header, a table of per-tile checksums and a payload that starts
+ * on a 4 KiB boundary (so it can be mmap'ed or read with O_DIRECT-sized
+ * requests):
+ *
+ *   header    MatrixFileHeader
+ *   checksums numTiles x uint64, tile (I, J) at I * tilesJ + J
+ *   padding   up to dataOffset
+ *   payload   rows x cols elements in 'order':
+ *             row-major, column-major, or tileSize x tileSize tiles in
+ *             row-major tile order, each tile contiguous and row-major
+ *             inside, edge tiles zero-padded to full size
+ *
+ * The checksums cover tileSize x tileSize tiles of the logical matrix for
+ * every order. A tile's checksum is a wrapping sum of a hash of each
+ * element's bits and position inside the tile, so it does not depend on the
+ * storage order and partial sums from different ranks or threads can simply
+ * be added. Files without the magic are raw row-major elements of the
+ * type selected with -t, as before.
+ *****************************************************************************/
+
+#define MATRIX_FILE_MAGIC    "MTXBIN1"
+#define MATRIX_FILE_VERSION  1
+#define MATRIX_FILE_ALIGN    4096
+#define MATRIX_FILE_MAX_TILE 65536   // positions inside a tile fit 32 bits
+
+// Same order as ElemType (simd_kernels.h)
+enum { MATRIX_FLOAT32 = 0, MATRIX_FLOAT64, MATRIX_INT8, MATRIX_INT16, MATRIX_INT32,
+       MATRIX_COMPLEX64 };
+enum { ORDER_ROW_MAJOR = 0, ORDER_COL_MAJOR = 1, ORDER_TILED = 2 };
+
+typedef struct {
+    char     magic[8];      // MATRIX_FILE_MAGIC, NUL-terminated
+    uint32_t version;       // MATRIX_FILE_VERSION
+    uint32_t elemType;      // MATRIX_FLOAT32 ... MATRIX_COMPLEX64
+    uint32_t order;         // ORDER_*
+    uint32_t tileSize;      // ORDER_TILED tile edge and checksum tile edge
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t dataOffset;    // payload start, a multiple of MATRIX_FILE_ALIGN
+    uint64_t numTiles;      // checksum table entries
+    uint64_t reserved;
+} MatrixFileHeader;
+
+/**
+ * @brief Fills in a header for a rows x cols matrix of the current element
+ *        type stored in 'order' with tileSize x tileSize checksum tiles.
+ */
+void matrixFileInitHeader(MatrixFileHeader *header, int rows, int cols,
+                          int order, int tileSize);
+
+// Returns 1 and fills 'header' if 'path' starts with a valid header, 0 for
+// raw files (or if it cannot be read), -1 (with a message) if it has the
+// magic but a header that does not agree with itself: dimensions above
+// INT_MAX, a numTiles or dataOffset that does not match them.
+int matrixFileProbe(const char *path, MatrixFileHeader *header);
+
+/**
+ * @brief Adds the checksum contributions of a rows x cols block of the
+ *        matrix at (rowOffset, colOffset) (leading dimension ld) to 'sums'
+ *        (header->numTiles entries), using the OpenMP threads.
+ */
+void matrixTileSums(const MatrixFileHeader *header, const void *block, int ld,
+                    int rowOffset, int colOffset, int rows, int cols, uint64_t *sums);
+
+/**
+ * @brief Serial/OpenMP loader and writer for whole matrices held in
+ *        row-major memory ('matrix' is rows x cols).
+ *
+ * matrixFileRead reads the payload with one read, converts column-major or
+ * tiled payloads with the OpenMP threads and verifies every tile checksum;
+ * the file must hold the current element type.
+ * Both return 0 on success and print a message otherwise.
+ */
+int matrixFileRead(const char *path, void *matrix, int rows, int cols);
+int matrixFileWrite(const char *path, const void *matrix, int rows, int cols,
+                    int order, int tileSize);
+
+#endif // MATRIX_IO_H
@@ -1,49 +1,167 @@
 #ifndef MATRIX_OPERATIONS_H
 #define MATRIX_OPERATIONS_H
 
+#include <stddef.h>
+#include "mpi_common.h"    // LocalPart
+#include "simd_kernels.h"  // ElemType, ELEM
+
+// Every matrix is a row-major array of the element type selected with
+// setElementType (-t); sizes and leading dimensions count elements.
+
 /*****************************************************************************
  * Serial Methods
  *****************************************************************************/
 
-int checkSym(float *matrix, int n);
-void matTranspose(float *matrix, float *transposed, int n);
+int checkSym(void *matrix, int n);
+void matTranspose(void *matrix, void *transposed, int n);
 
 /*****************************************************************************
  * Block-Based Serial Methods
  *****************************************************************************/
 
-int checkSymBlock(float *matrix, int n, int blockSize);
+int checkSymBlock(void *matrix, int n, int blockSize);
+
+void matTransposeBlock(void *matrix, void *transposed, int n, int blockSize);
+void matTransposeInPlace(void *matrix, int n, int blockSize);
 
-void matTransposeBlock(float *matrix, float *transposed, int n, int blockSize);
+// rows x cols input, cols x rows output
+void matTransposeBlockRect(void *matrix, void *transposed, int rows, int cols, int blockSize);
+void matTransposeInPlaceRect(void *matrix, int rows, int cols, int blockSize);
 
 /*****************************************************************************
  * OpenMP Block-Based Methods
  *****************************************************************************/
 
-int checkSymOMP(float *matrix, int n);
-void matTransposeOMP(float *matrix, float *transposed, int n);
+int checkSymOMP(void *matrix, int n, int blockSize);
+void matTransposeOMP(void *matrix, void *transposed, int n, int blockSize);
+void matTransposeInPlaceOMP(void *matrix, int n, int blockSize);
+
+void matTransposeOMPRect(void *matrix, void *transposed, int rows, int cols, int blockSize);
+void matTransposeInPlaceRectOMP(void *matrix, int rows, int cols, int blockSize);
+
+/*****************************************************************************
+ * Cache-Oblivious Recursive Methods
+ *****************************************************************************/
+
+void matTransposeRecursive(void *matrix, void *transposed, int n);
+void matTransposeRecursiveOMP(void *matrix, void *transposed, int n);
+
+void matTransposeRecursiveRect(void *matrix, void *transposed, int rows, int cols);
+void matTransposeRecursiveOMPRect(void *matrix, void *transposed, int rows, int cols);
+
+/*****************************************************************************
+ * Batched Methods (many small matrices)
+ *****************************************************************************/
+
+// count independent rows x cols matrices, each into its own cols x rows
+// output, in one call: mats[k] / outs[k], or for the strided variants
+// matrix k at mats + k * strideIn and its transpose at outs + k * strideOut
+// (strides in elements). The OpenMP threads share the whole batch.
+void matTransposeBatch(void **mats, void **outs, int count, int n, int blockSize);
+void matTransposeBatchRect(void **mats, void **outs, int count, int rows, int cols,
+                           int blockSize);
+void matTransposeBatchStrided(const void *mats, long strideIn, void *outs, long strideOut,
+                              int count, int rows, int cols, int blockSize);
+
+// Same on all ranks: the batch lives on rank 0 and whole matrices are dealt
+// out to the ranks with one scatter and one gather per batch.
+void matTransposeBatchMPI(void **mats, void **outs, int count, int rows, int cols,
+                          int blockSize);
+void matTransposeBatchStridedMPI(const void *mats, long strideIn, void *outs, long strideOut,
+                                 int count, int rows, int cols, int blockSize);
+
+/*****************************************************************************
+ * Out-of-Core Method
+ *****************************************************************************/
+
+// Transposes the row-major payload of inPath (rows x cols, starting
+// at inOffset) into the raw file outPath through mmap, keeping about
+// budgetBytes of both files resident (see --mem-budget).
+void matTransposeOutOfCore(const char *inPath, long inOffset, const char *outPath,
+                           int rows, int cols, size_t budgetBytes, int blockSize);
 
 /*****************************************************************************
  * MPI Methods (Regular)
  *****************************************************************************/
 
-int checkSymMPI(float *matrix, int n);
-int checkSymMPI2(float *matrix, int n);
-int checkSymMPI3(float *matrix, int n);
+int checkSymMPI(void *matrix, int n);
+int checkSymMPI2(void *matrix, int n);
+int checkSymMPI3(void *matrix, int n);
+
 
+void matTransposeMPI(void *matrix, void *transposed, int n);
+void matTransposeMPI2(void *matrix, void *transposed, int n);
+void matTransposeMPI3(void *matrix, void *transposed, int n);
+void matTransposeInPlaceMPI3(void *matrix, int n);
+void matTransposeMPI4(void *matrix, void *transposed, int n);  // checked with checkSymMPI3
 
-void matTransposeMPI(float *matrix, float *transposed, int n);
-void matTransposeMPI2(float *matrix, float *transposed, int n);
-void matTransposeMPI3(float *matrix, float *transposed, int n);
+void matTransposeMPIRect(void *matrix, void *transposed, int rows, int cols);
+void matTransposeMPI2Rect(void *matrix, void *transposed, int rows, int cols);
+void matTransposeMPI3Rect(void *matrix, void *transposed, int rows, int cols);
+void matTransposeMPI4Rect(void *matrix, void *transposed, int rows, int cols);
+
+// --distributed-output: no final gather, each rank keeps its part of T
+void matTransposeMPIDist(void *matrix, int rows, int cols, LocalPart *part);
+void matTransposeMPI2Dist(void *matrix, int rows, int cols, LocalPart *part);
+void matTransposeMPI3Dist(void *matrix, int rows, int cols, LocalPart *part);
+void matTransposeMPI4Dist(void *matrix, int rows, int cols, LocalPart *part);
 
 /*****************************************************************************
  * MPI Methods (Block-Based)
  *****************************************************************************/
 
-int checkSymBlockMPI1(float *matrix, int n);
-void matTransposeBlockMPI1(float *matrix, float *transposed, int n);
+int checkSymBlockMPI1(void *matrix, int n);
+void matTransposeBlockMPI1(void *matrix, void *transposed, int n);
+void matTransposeBlockMPI1Rect(void *matrix, void *transposed, int rows, int cols);
+
+int checkSymBlockMPI3(void *matrix, int n);
+void matTransposeBlockMPI3(void *matrix, void *transposed, int n);
+void matTransposeBlockMPI3Rect(void *matrix, void *transposed, int rows, int cols);
+
+void matTransposeBlockMPI1Dist(void *matrix, int rows, int cols, LocalPart *part);
+void matTransposeBlockMPI3Dist(void *matrix, int rows, int cols, LocalPart *part);
+
+/*****************************************************************************
+ * MPI Methods (2D Block-Cyclic)
+ *****************************************************************************/
+
+// Any rank count (P x Q grid from MPI_Dims_create) and any size; nb is the
+// block-cyclic block size (-b). Checked with checkSymMPI3.
+void matTransposeBlockCyclicMPI(void *matrix, void *transposed, int n, int nb);
+void matTransposeBlockCyclicMPIRect(void *matrix, void *transposed, int rows, int cols, int nb);
+
+/*****************************************************************************
+ * MPI Methods (Shared Memory)
+ *
+ * For ranks that all share one node. M and T live once, in MPI shared
+ * windows (MPI_Win_allocate_shared over the MPI_COMM_TYPE_SHARED split of
+ * MPI_COMM_WORLD), and every rank addresses all of both with plain loads
+ * and stores. Rank r owns the row slab [slabStart(cols, r), ...) of T: it
+ * first-touches that slab and its row slab of M, and the transpose writes
+ * it straight from the column strip of M. No element is ever sent; the
+ * only communication is MPI_Win_sync + barrier around each step.
+ *****************************************************************************/
+
+typedef struct ShmMatrices ShmMatrices;
+
+/**
+ * @brief Allocates the shared rows x cols M and cols x rows T. Collective;
+ *        returns NULL, with a message on rank 0, when MPI_COMM_WORLD spans
+ *        more than one node.
+ */
+ShmMatrices *shmMatricesCreate(int rows, int cols);
+void shmMatricesFree(ShmMatrices *shm);
+
+// All of M / of T, on every rank.
+void *shmInput(const ShmMatrices *shm);
+void *shmOutput(const ShmMatrices *shm);
+
+// Every rank fills its row slab of M with loadLocalBlock (--local-init,
+// --input). Collective.
+void shmLoadInput(ShmMatrices *shm);
 
-int checkSymBlockMPI3(float *matrix, int n);
-void matTransposeBlockMPI3(float *matrix, float *transposed, int n);
+// Collective; M may have been written by any rank since the last call.
+int  checkSymShm(ShmMatrices *shm, int blockSize);
+void matTransposeShm(ShmMatrices *shm, int blockSize);
 
 #endif // MATRIX_OPERATIONS_H
@@ -0,0 +1,196 @@
+#ifndef MPI_COMMON_H
+#define MPI_COMMON_H
+
+#include <mpi.h>
+#include "matrix_io.h"   // MatrixFileHeader
+
+/*****************************************************************************
+ * Derived Datatypes for Sub-Blocks
+ *
+ * Both constructors return a committed type describing one rows x cols
+ * block of the selected element type (see setElementType) in place inside
+ * a larger row-major array with leading dimension ld, so blocks can be sent
+ * from / received into the global or local matrix directly, without a
+ * packing buffer. Release with MPI_Type_free.
+ *****************************************************************************/
+
+/**
+ * @brief MPI datatype of one element: MPI_FLOAT, MPI_DOUBLE, MPI_INT8_T,
+ *        MPI_INT16_T, MPI_INT32_T or MPI_C_FLOAT_COMPLEX. Every count in
+ *        the MPI methods is in these units.
+ */
+MPI_Datatype elementMPIType(void);
+
+/**
+ * @brief Block type: element (r,c) at offset r*ld + c.
+ */
+MPI_Datatype createBlockType(int ld, int rows, int cols);
+
+/**
+ * @brief "Transposed column" type: a rows x cols block arriving in
+ *        row-major order is stored transposed, element (r,c) at c*ld + r.
+ *
+ * Receiving a contiguous (or createBlockType) message with this type makes
+ * the MPI library do the transpose while it unpacks.
+ */
+MPI_Datatype createTransposedBlockType(int ld, int rows, int cols);
+
+/*****************************************************************************
+ * Hybrid MPI + OpenMP
+ *
+ * main initializes MPI with MPI_THREAD_FUNNELED: only the master thread of
+ * a rank calls MPI, while the rank's OpenMP threads (OMP_NUM_THREADS, 1 for
+ * pure MPI) do the local transposes, packing and unpacking.
+ *****************************************************************************/
+
+/**
+ * @brief transposeBlocked with the blockSize tiles spread over the calling
+ *        rank's OpenMP threads (serial when called inside a parallel region).
+ */
+void transposeBlockedThreads(const void *src, int lds, void *dst, int ldd,
+                             int rows, int cols, int blockSize);
+
+/*****************************************************************************
+ * Distributed Output (--distributed-output)
+ *
+ * The *Dist variants of the MPI methods stop before the final gather and
+ * leave each rank with the part of the result T (cols x rows) it computed.
+ *****************************************************************************/
+
+// A rectangle of a distributed global matrix (T for the *Dist methods,
+// M for checkSymDistributed).
+typedef struct {
+    int    rowOffset;   // global row where this part starts
+    int    colOffset;   // global column where this part starts
+    int    localRows;   // rows held here
+    int    localCols;   // columns held here
+    int    ld;          // leading dimension of 'data'
+    void  *data;        // owned by the part, see freeLocalPart
+} LocalPart;
+
+/**
+ * @brief Optional collection step: rank 0 receives every rank's part
+ *        directly into its position of 'transposed' (tRows x tCols).
+ *
+ * Collective; 'transposed' is only used on rank 0, which aborts if a part
+ * does not fit inside it.
+ */
+void collectLocalParts(const LocalPart *part, void *transposed, int tRows, int tCols);
+
+void freeLocalPart(LocalPart *part);
+
+/*****************************************************************************
+ * Input Source (--local-init, --input)
+ *
+ * By default the MPI methods scatter M from rank 0. After setLocalInit,
+ * every rank instead generates exactly the rows or block of M it works on
+ * with the counter-based generator (see initializeMatrixBlock); after
+ * setInputFile it reads them from a file with MPI-IO (a view per rank and
+ * one MPI_File_read_all): a raw row-major file or the payload of a binary
+ * matrix file (dataOffset, see matrix_io.h) in any order. Row-major parts
+ * are read in place. A column-major part is read as the mirrored block and
+ * transposed locally. A tiled file is read as whole tiles (a subarray of
+ * the tile grid, every tile one contiguous run) and each rank untiles
+ * only its own part. Either way M never has to exist on rank 0 and the
+ * initial scatter disappears. For a binary matrix file every rank adds up
+ * the tile checksums of what it reads, and closeInputFile sums them on
+ * rank 0 and aborts if they disagree with the file's table.
+ * closeInputFile returns to the scatter from rank 0.
+ *****************************************************************************/
+
+void setLocalInit(int seed, int symmetric);
+// Collective. 'header' is that of a binary matrix file, NULL for raw files.
+void setInputFile(const char *path, int rows, int cols, const MatrixFileHeader *header);
+void closeInputFile(void);                                                       // collective
+int  localSourceEnabled(void);
+int  inputFileEnabled(void);
+
+/**
+ * @brief Loads rows x cols elements of M starting at (rowOffset, colOffset)
+ *        into 'block' (leading dimension ld).
+ *
+ * Collective with --input: every rank calls it once, with an empty block
+ * if it has nothing to read.
+ */
+void loadLocalBlock(void *block, int ld, int rowOffset, int colOffset,
+                    int rows, int cols);
+
+// --input only: collective read of 'count' elements through 'filetype', a
+// committed view of the global row-major M (e.g. a darray). Row-major
+// input files only; the caller hands every block it got to addInputTileSums.
+void readInputView(MPI_Datatype filetype, void *buf, int count);
+
+// --input only: counts a block of M read outside loadLocalBlock towards the
+// checksums closeInputFile verifies.
+void addInputTileSums(const void *block, int ld, int rowOffset, int colOffset,
+                      int rows, int cols);
+
+/*****************************************************************************
+ * Output File (--output)
+ *
+ * Every rank writes its part of T straight to its place in a row-major file
+ * with a subarray view and one MPI_File_write_all, so the result never has
+ * to be gathered on rank 0.
+ *****************************************************************************/
+
+// Collective; a rank with nothing to write passes an empty part. tileSize 0
+// writes a raw file, otherwise a binary matrix file with tileSize checksum
+// tiles, whose partial sums are reduced on rank 0.
+void writeLocalPart(const char *path, const LocalPart *part, int tRows, int tCols, int tileSize);
+
+/*****************************************************************************
+ * Row Slabs (mpi, mpi2, mpi3, mpi4, row-slab symmetry check)
+ *
+ * An n-row matrix is split into one slab of consecutive rows per rank, for
+ * any n and p: rank r owns rows [slabStart(n, r), slabStart(n, r + 1)).
+ * Slabs are balanced to within one row, or, after setSlabAlign(a)
+ * (--slab-align), their boundaries are rounded to multiples of a. The
+ * slabs of T are the column ranges of M, so a = 16 makes every block that
+ * is cut out of a row of M start on a 64-byte line (for aligned rows).
+ * Uneven slabs move with MPI_Scatterv / MPI_Gatherv and per-peer blocks.
+ *****************************************************************************/
+
+void setSlabAlign(int align);
+int  slabStart(int n, int r);
+int  slabStartOf(int n, int r, int size);  // same for a communicator of 'size' ranks
+
+/**
+ * @brief Fills localM with this rank's slab of the rows x cols matrix M:
+ *        generated locally with --local-init, otherwise scattered from
+ *        rank 0's 'matrix'.
+ */
+void scatterRows(const void *matrix, void *localM, int rows, int cols);
+
+/**
+ * @brief Gathers every rank's slab of the tRows x tCols matrix T (from
+ *        localT) into 'transposed' on rank 0.
+ */
+void gatherRows(const void *localT, void *transposed, int tRows, int tCols);
+
+/*****************************************************************************
+ * Distributed Symmetry Check
+ *
+ * Every rank holds one rectangle of the n x n matrix M (any tiling: row
+ * slabs, 2D blocks, ...). For each pair of ranks only the part of the
+ * other rank's rectangle that mirrors the upper triangle of ours is sent,
+ * straight from its storage; received blocks are transposed with the tile
+ * kernels and compared row by row with elementsEqual. Memory and traffic per
+ * rank are O(n^2/p); nothing is broadcast. The mirrors travel in bands of
+ * 256 columns, one band per round, and each round opens with an allreduce
+ * on "mismatch found?": after a mismatch no further band is sent.
+ *****************************************************************************/
+
+// 'part' describes this rank's rectangle of M. Collective.
+int checkSymDistributed(const LocalPart *part, int n);
+
+/**
+ * @brief Wrappers for the MPI methods: rank 0's 'matrix' is split into
+ *        balanced row slabs (checkSymRowsMPI) or sqrt(p) x sqrt(p) blocks
+ *        (checkSymBlocksMPI, falling back to slabs when p is not a perfect
+ *        square or n % sqrt(p) != 0), or generated in place with
+ *        --local-init, and checked with checkSymDistributed.
+ */
+int checkSymRowsMPI(const void *matrix, int n);
+int checkSymBlocksMPI(const void *matrix, int n);
+
+#endif // MPI_COMMON_H
@@ -0,0 +1,48 @@
+#ifndef NUMA_PLACEMENT_H
+#define NUMA_PLACEMENT_H
+
+/*****************************************************************************
+ * NUMA Placement (--numa)
+ *
+ * Linux places a page on the NUMA node of the thread that first writes it.
+ * When rank 0 allocates M and T and then fills M from whatever thread
+ * happens to run the generator, pages can end up on one socket. Threads of
+ * matTransposeOMP running on the other socket then read and write across
+ * the interconnect.
+ *
+ * With placement enabled the OpenMP tile loop uses a static schedule, and
+ * firstTouchOMP writes every page of M and T first from the thread that
+ * will later read that tile of M or write the mirrored tile of T. The same
+ * static mapping over the same flattened tiles is used for both, so each
+ * thread's tiles sit on its own node. The mapping only depends weakly on
+ * blockSize (thread t owns about rows [t*rows/T, (t+1)*rows/T) of M).
+ *
+ * pinThreads binds every OpenMP thread to one CPU of the process's
+ * affinity mask. CPUs are ordered by NUMA node, so consecutive threads, and
+ * therefore consecutive tile ranges, share a node. If OMP_PROC_BIND is
+ * already set, the runtime's binding is kept.
+ *****************************************************************************/
+
+void setNumaPlacement(int enabled);
+int  numaPlacementEnabled(void);
+
+// Returns 1 if it pinned the threads, 0 if OMP_PROC_BIND already binds them.
+int  pinThreads(void);
+
+/**
+ * @brief Zeroes the rows x cols 'matrix' and its cols x rows 'transposed'
+ *        (either may be NULL) tile by tile with the static tile-to-thread
+ *        mapping of matTransposeOMPRect, so every page lands on the node of
+ *        the thread that will use it.
+ */
+void firstTouchOMP(void *matrix, void *transposed, int rows, int cols, int blockSize);
+
+/**
+ * @brief Prints the placement: NUMA nodes, threads per node, the share of
+ *        the pages of M and T on each node (move_pages), and the fraction of
+ *        tiles each thread reads from / writes to its own node.
+ */
+void reportPlacement(const void *matrix, const void *transposed, int rows, int cols,
+                     int blockSize);
+
+#endif // NUMA_PLACEMENT_H
@@ -0,0 +1,126 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <stddef.h>
+
+/*****************************************************************************
+ * Element Type (-t)
+ *
+ * Every method moves opaque elements of elementBytes() bytes: the matrix
+ * pointers are void *, leading dimensions and counts stay in elements, and
+ * the tile kernels, MPI datatype (elementMPIType), generator and file format
+ * follow the type selected here. The default is float.
+ *****************************************************************************/
+
+typedef enum {
+    ELEM_FLOAT,     // "float"
+    ELEM_DOUBLE,    // "double"
+    ELEM_I8,        // "i8"
+    ELEM_I16,       // "i16"
+    ELEM_I32,       // "i32"
+    ELEM_C64,       // "c64": complex float, (re, im) pairs
+    ELEM_TYPE_COUNT
+} ElemType;
+
+// Selects the element type by name; returns 0 if unknown.
+int setElementType(const char *name);
+ElemType elementType(void);
+const char *elementTypeName(ElemType type);
+size_t elementBytes(void);
+
+// Address of element k of an array of the selected type
+#define ELEM(p, k) ((void *)((char *)(p) + (size_t)(k) * elementBytes()))
+
+/*****************************************************************************
+ * Register-Tile Transpose Kernels
+ *
+ * Micro-kernels that transpose a square tile entirely in registers, one per
+ * element width: SSE (4x4 floats, 2x2 doubles), AVX2 (8x8 floats, 4x4
+ * doubles) and AVX-512 (16x16 floats, 8x8 doubles); i32 uses the float
+ * kernels and c64 the double ones. Narrow types get wider tiles from SSE2
+ * byte and word interleaves at every level: 16x16 for 8-bit and 8x8 for
+ * 16-bit elements. The widest kernel supported by the CPU is
+ * selected once at startup (cpuid); until then, and on non-x86 builds,
+ * scalar kernels are used.
+ *****************************************************************************/
+
+void initTransposeKernels(void);
+const char *transposeKernelName(void);
+
+// Kernels usable on this CPU ("scalar", "sse", "avx2", "avx512"), narrowest first.
+int transposeKernelNames(const char **names, int maxNames);
+// Force a kernel by name (e.g. from the autotuner); returns 0 if unsupported.
+int setTransposeKernel(const char *name);
+
+/**
+ * @brief Transposes a rows x cols sub-matrix: dst[c*ldd + r] = src[r*lds + c].
+ *
+ * Full tiles go through the selected register kernel, ragged edges are
+ * handled with scalar code. Meant for cache-sized blocks.
+ */
+void transposeTile(const void *src, int lds, void *dst, int ldd, int rows, int cols);
+
+/**
+ * @brief Returns 1 if a[0..n) == b[0..n) element-wise for the selected
+ *        element type (a NaN never matches; float and complex compare with
+ *        the vector width of the selected kernel).
+ */
+int elementsEqual(const void *a, const void *b, int n);
+
+/**
+ * @brief Returns 1 if a[i][j] == a[j][i] for j0 <= j < j1 (leading dimension
+ *        ld): row i against the mirrored column, gathered in short runs and
+ *        compared with elementsEqual.
+ */
+int mirrorEqual(const void *a, int ld, int i, int j0, int j1);
+
+/**
+ * @brief Same as transposeTile, but walks the sub-matrix in
+ *        blockSize x blockSize cache blocks first.
+ */
+void transposeBlocked(const void *src, int lds, void *dst, int ldd,
+                      int rows, int cols, int blockSize);
+
+/**
+ * @brief Streaming-store path for outputs that do not fit in the last-level
+ *        cache.
+ *
+ * Ordinary stores into a large 'transposed' buffer first read every
+ * destination line (read-for-ownership). transposeTileStream transposes
+ * into a small L1-resident staging tile and writes whole output lines with
+ * non-temporal stores instead. Each thread that used it must call
+ * streamFence() once before its results are read.
+ *
+ * useStreamingStores(bytes) decides whether an output of that size should
+ * take this path: yes if it exceeds lastLevelCacheBytes() (sysconf, then
+ * sysfs, then 32 MiB). MATTRANSPOSE_STREAM=0/1 forces it off/on.
+ */
+size_t lastLevelCacheBytes(void);
+int useStreamingStores(size_t outputBytes);
+void transposeTileStream(const void *src, int lds, void *dst, int ldd, int rows, int cols);
+void streamFence(void);
+
+/**
+ * @brief In-place helpers for square transposes.
+ *
+ * transposeSwapTiles: a is rows x cols, b is cols x rows (both with leading
+ * dimension ld); afterwards a holds old b^T and b holds old a^T. This is the
+ * (i,j) <-> (j,i) tile swap across the diagonal.
+ *
+ * transposeBlockedInPlace: transposes the n x n sub-matrix at a in place,
+ * swapping blockSize tiles across the diagonal.
+ */
+void transposeSwapTiles(void *a, void *b, int ld, int rows, int cols);
+void transposeBlockedInPlace(void *a, int ld, int n, int blockSize);
+
+/**
+ * @brief Transposes a P x Q grid of segments (each L contiguous elements) in
+ *        place by cycle-following, using a one-bit-per-segment visited map.
+ *
+ * With L == 1 this is the plain element-wise in-place rectangular transpose;
+ * larger L moves whole rows of a tile at a time, which keeps the permutation
+ * cache friendly.
+ */
+void transposeSegmentsInPlace(void *a, long P, long Q, long L);
+
+#endif // SIMD_KERNELS_H
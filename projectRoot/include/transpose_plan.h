@@ -0,0 +1,45 @@
+#ifndef TRANSPOSE_PLAN_H
+#define TRANSPOSE_PLAN_H
+
+#include <mpi.h>
+
+/*****************************************************************************
+ * Transpose Plans (--plan)
+ *
+ * For loops that transpose a same-shaped matrix many times. Creating a plan
+ * does all the set-up of one method once: the row-slab decomposition, one
+ * pooled 64-byte aligned allocation for the local slabs and exchange
+ * buffers, the committed row datatypes and persistent requests
+ * (MPI_Send_init / MPI_Recv_init) for the scatter, the exchange and the
+ * gather. Executing it only starts and completes those requests and runs the
+ * kernels: no allocation, no datatype or communicator calls.
+ *
+ * Like an FFTW plan, a plan is bound to its arrays: 'matrix' and
+ * 'transposed' on rank 0 (ignored elsewhere), whose contents may change
+ * between executions. The plan also snapshots the element type and
+ * --slab-align in effect when it is created: its datatypes, requests and
+ * buffer offsets use that element size, and an execution switches the
+ * kernels to that type for its duration if -t has changed since.
+ *
+ * Methods: serialblock and omp (rank 0 only, blockSize tiles) and mpi4
+ * (row slabs, all exchanges in flight at once; see matTransposeMPI4Rect).
+ *****************************************************************************/
+
+typedef struct TransposePlan TransposePlan;
+
+/**
+ * @brief Builds a plan for transposing the rows x cols 'matrix' into
+ *        'transposed' with 'method'. Collective over 'comm' (which the plan
+ *        duplicates). Returns NULL, with a message on rank 0, for a method
+ *        that has no plan.
+ */
+TransposePlan *transposePlanCreate(void *matrix, void *transposed, int n,
+                                   const char *method, int blockSize, MPI_Comm comm);
+TransposePlan *transposePlanCreateRect(void *matrix, void *transposed, int rows, int cols,
+                                       const char *method, int blockSize, MPI_Comm comm);
+
+// Collective over the plan's communicator.
+void transposePlanExecute(TransposePlan *plan);
+void transposePlanDestroy(TransposePlan *plan);
+
+#endif // TRANSPOSE_PLAN_H
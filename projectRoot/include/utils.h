@@ -7,11 +7,25 @@
 #include <sys/time.h>
 
 
-void initializeMatrix(float *matrix, int n, int seed);
-void initializeSymmetricMatrix(float *matrix, int n, int seed);
+// Matrices hold the element type selected with setElementType. Element
+// (i,j) of the generated matrix is the same on every rank and thread.
+void initializeMatrix(void *matrix, int n, int seed);
+void initializeMatrixRect(void *matrix, int rows, int cols, int seed);
+void initializeSymmetricMatrix(void *matrix, int n, int seed);
 
-void printMatrix(const float *matrix, int n);
+// Generates rows x cols elements of the global matrix starting at
+// (rowOffset, colOffset) into 'block' (leading dimension ld), in parallel.
+void initializeMatrixBlock(void *block, int ld, int rowOffset, int colOffset,
+                           int rows, int cols, int seed, int symmetric);
 
-float partialChecksum(const float *matrix, int n);
+void printMatrix(const void *matrix, int n);
+void printMatrixRect(const void *matrix, int rows, int cols);
+
+// Checksums convert every element to float (complex: re + 2 im)
+float partialChecksum(const void *matrix, int n);
+float partialChecksumRect(const void *matrix, int rows, int cols);
+float partialChecksumGenerated(int rows, int cols, int seed, int symmetric);
+float partialChecksumFile(const char *path, long offset, int rows, int cols,
+                          int order, int tileSize);
 
 #endif // UTILS_H
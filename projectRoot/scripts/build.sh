@@ -11,16 +11,29 @@ mkdir -p ../bin
 
 echo "Building HPC Project..."
 
-mpicc -std=c99 -fopenmp -o ../bin/main \
+mpicc -std=c99 -O3 -fopenmp -o ../bin/main \
     ../src/main.c \
     ../src/serialblock_code.c \
     ../src/openmp_code.c \
+    ../src/recursive_code.c \
+    ../src/outofcore_code.c \
+    ../src/batch_code.c \
+    ../src/plan_code.c \
+    ../src/numa_placement.c \
+    ../src/matrix_alloc.c \
     ../src/mpi_code.c \
     ../src/mpi_code2.c \
     ../src/mpi_code3.c \
+    ../src/mpi_code4.c \
     ../src/mpiblock_code1.c \
     ../src/mpiblock_code3.c \
+    ../src/mpiblock_cyclic.c \
+    ../src/mpishm_code.c \
+    ../src/mpi_common.c \
+    ../src/matrix_io.c \
     ../src/utils.c \
+    ../src/simd_kernels.c \
+    ../src/autotune.c \
     -I ../include -lm
 
 echo "Build completed. Binaries are in ../bin/"
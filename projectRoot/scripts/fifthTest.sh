@@ -105,7 +105,7 @@ run_mpi3_test() {
     local -a times=()
     for ((i=1; i<=RUNS; i++)); do
         local output
-        output=$(mpirun -np "$procs" "$BIN_PATH" -m mpi3 -n "$size" 2>&1)
+        output=$(OMP_NUM_THREADS=1 mpirun -np "$procs" "$BIN_PATH" -m mpi3 -n "$size" 2>&1)
 
         local t
         t=$(echo "$output" | grep "Transpose time:" | awk -F': ' '{print $2}' | awk '{print $1}')
@@ -141,7 +141,7 @@ run_mpiblocks3_test() {
     local -a times=()
     for ((i=1; i<=RUNS; i++)); do
         local output
-        output=$(mpirun -np "$procs" "$BIN_PATH" -m mpi_blocks3 -n "$size" 2>&1)
+        output=$(OMP_NUM_THREADS=1 mpirun -np "$procs" "$BIN_PATH" -m mpi_blocks3 -n "$size" 2>&1)
 
         local t
         t=$(echo "$output" | grep "Transpose time:" | awk -F': ' '{print $2}' | awk '{print $1}')
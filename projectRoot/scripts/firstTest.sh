@@ -24,7 +24,7 @@ run_and_record_results() {
 
     # Ensure matrix size is divisible by number of processors for MPI runs
     if (( matrix_size % procs == 0 )); then
-        local time_output=$(mpirun -np $procs $BIN_PATH -m $method -n $matrix_size 2>&1)
+        local time_output=$(OMP_NUM_THREADS=1 mpirun -np $procs $BIN_PATH -m $method -n $matrix_size 2>&1)
         echo "Output for $method with size $matrix_size and procs $procs:"
         echo "$time_output"
         echo "------------------------------------------------------"
@@ -48,6 +48,8 @@ for size in "${MATRIX_SIZES[@]}"; do
         run_and_record_results "mpi" "$size" "$procs"
         run_and_record_results "mpi2" "$size" "$procs"
         run_and_record_results "mpi3" "$size" "$procs"
+        run_and_record_results "mpi4" "$size" "$procs"
+        run_and_record_results "mpi_shm" "$size" "$procs"
     done
 done
 
@@ -4,7 +4,7 @@
 BIN_PATH="../bin/main"
 
 # Parameters
-OMP_THREADS=16
+OMP_THREADS=16                        # recursive_omp only; every other run is flat (1 thread)
 # Arrays for MPI process counts
 MPI_PROCS_BLOCK=(4 16 64)
 # Matrix sizes, ensuring each size is a power of two for divisibility
@@ -23,11 +23,12 @@ run_and_record_results() {
     local method=$1
     local matrix_size=$2
     local procs=$3
+    local threads=${4:-1}
 
     # Ensure matrix size is divisible by number of processors for MPI runs
     if (( matrix_size % procs == 0 )); then
         # Run the method and capture full output for debugging
-        local time_output=$(mpirun -np $procs $BIN_PATH -m $method -n $matrix_size 2>&1)
+        local time_output=$(OMP_NUM_THREADS=$threads mpirun -np $procs $BIN_PATH -m $method -n $matrix_size 2>&1)
         echo "Output for $method with size $matrix_size and procs $procs:"
         echo "$time_output"
         echo "------------------------------------------------------"
@@ -50,6 +51,9 @@ run_and_record_results() {
 for size in "${MATRIX_SIZES[@]}"; do
     # Run serial and MPI methods
     run_and_record_results "serialblock" "$size" "1"
+    # Cache-oblivious recursive transposes (no block size to tune)
+    run_and_record_results "recursive" "$size" "1"
+    run_and_record_results "recursive_omp" "$size" "1" "$OMP_THREADS"
     for procs in "${MPI_PROCS_BLOCK[@]}"; do
         run_and_record_results "mpi_blocks3" "$size" "$procs"
     done
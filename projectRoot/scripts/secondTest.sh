@@ -89,7 +89,7 @@ run_mpi3_test() {
 
     for ((i=1; i<=RUNS; i++)); do
         local output
-        output=$(mpirun -np "$procs" "$BIN_PATH" -m mpi3 -n "$size" 2>&1)
+        output=$(OMP_NUM_THREADS=1 mpirun -np "$procs" "$BIN_PATH" -m mpi3 -n "$size" 2>&1)
         
         # Extract transpose time
         local t
@@ -0,0 +1,97 @@
+#!/usr/bin/env bash
+
+################################################################################
+# Paths and Files
+################################################################################
+BIN_PATH="../bin/main"        # Path to your compiled executable
+CSV_FILE="../results/results6.csv"
+TXT_FILE="../results/results6.txt"
+
+################################################################################
+# Configuration
+################################################################################
+MATRIX_SIZES=(32 64 128 256 512)
+BATCH_ELEMENTS=$((1 << 24))   # elements per batch: 64 MiB of floats in, 64 MiB out
+THREADS=(1 4 16)              # batch: OpenMP threads on one rank
+PROCS=(1 4 16)                # mpi_batch: ranks, one thread each
+RUNS=5  # number of runs per configuration
+
+################################################################################
+# Init Output Files
+################################################################################
+echo "Method,MatrixSize,Batch,Procs,Threads,AvgTime,MatricesPerSec" > "$CSV_FILE"
+echo "Batched Transpose Throughput:" > "$TXT_FILE"
+
+################################################################################
+# Helper: Remove outliers & compute average (as in fifthTest.sh)
+################################################################################
+compute_average_without_outliers() {
+    local -a all_times=("$@")
+    local count="${#all_times[@]}"
+    if (( count == 0 )); then
+        echo ""
+        return
+    fi
+
+    local -a sorted
+    mapfile -t sorted < <(printf '%s\n' "${all_times[@]}" | sort -n)
+
+    # Fewer than 3 data points: plain average
+    if (( count < 3 )); then
+        printf '%s\n' "${sorted[@]}" | awk '{s += $1} END {printf "%.6f", s / NR}'
+        return
+    fi
+
+    # If >= 3 data points, drop min & max
+    printf '%s\n' "${sorted[@]:1:$((count-2))}" | awk '{s += $1} END {printf "%.6f", s / NR}'
+}
+
+################################################################################
+# Run one batched configuration and record matrices per second
+################################################################################
+run_batch_test() {
+    local method="$1"
+    local size="$2"
+    local procs="$3"
+    local threads="$4"
+    local batch=$(( BATCH_ELEMENTS / (size * size) ))
+
+    local -a times=()
+    for ((i=1; i<=RUNS; i++)); do
+        local output
+        output=$(OMP_NUM_THREADS="$threads" mpirun -np "$procs" "$BIN_PATH" -m "$method" \
+                 -n "$size" --batch "$batch" 2>&1)
+
+        local t
+        t=$(echo "$output" | grep "Transpose time:" | awk -F': ' '{print $2}' | awk '{print $1}')
+        if [[ -n "$t" ]]; then
+            times+=("$t")
+        fi
+    done
+
+    if (( ${#times[@]} > 0 )); then
+        local avg_time
+        avg_time=$(compute_average_without_outliers "${times[@]}")
+        if [[ -n "$avg_time" ]]; then
+            local rate
+            rate=$(awk -v b="$batch" -v t="$avg_time" 'BEGIN {printf "%.1f", (t > 0) ? b / t : 0}')
+            echo "$method,$size,$batch,$procs,$threads,$avg_time,$rate" >> "$CSV_FILE"
+            echo "$method | Size: $size | Batch: $batch | Procs: $procs | Threads: $threads | Time: $avg_time | Matrices/s: $rate" >> "$TXT_FILE"
+        fi
+    fi
+}
+
+################################################################################
+# Main loop: for each size, the threaded batch on one rank and the
+# MPI batch on several ranks, both over the same number of elements
+################################################################################
+for size in "${MATRIX_SIZES[@]}"; do
+    for threads in "${THREADS[@]}"; do
+        run_batch_test batch "$size" 1 "$threads"
+    done
+    for procs in "${PROCS[@]}"; do
+        run_batch_test mpi_batch "$size" "$procs" 1
+    done
+done
+
+echo "Results saved to $CSV_FILE and $TXT_FILE."
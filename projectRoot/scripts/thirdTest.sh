@@ -27,7 +27,7 @@ run_and_record_results() {
     # Ensure matrix size is divisible by number of processors for MPI runs
     if (( matrix_size % procs == 0 )); then
         # Run the method and capture full output for debugging
-        local time_output=$(mpirun -np $procs $BIN_PATH -m $method -n $matrix_size 2>&1)
+        local time_output=$(OMP_NUM_THREADS=1 mpirun -np $procs $BIN_PATH -m $method -n $matrix_size 2>&1)
         echo "Output for $method with size $matrix_size and procs $procs:"
         echo "$time_output"
         echo "------------------------------------------------------"
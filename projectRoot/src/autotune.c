@@ -0,0 +1,328 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <omp.h>
+#include "autotune.h"
+#include "matrix_operations.h"
+#include "simd_kernels.h"
+
+#define TUNE_MAX_ENTRIES 256
+#define TUNE_LINE        512
+#define TUNE_REPS        3
+
+static const int tuneBlockSizes[] = { 16, 32, 64, 128, 256 };
+static const int tuneBlockCount   = sizeof(tuneBlockSizes) / sizeof(tuneBlockSizes[0]);
+
+int autotuneSupported(const char *method)
+{
+    return strcmp(method, "serialblock") == 0 || strcmp(method, "omp") == 0;
+}
+
+/*****************************************************************************
+ * Tuning key
+ *****************************************************************************/
+
+static void cpuModel(char *out, size_t outSize)
+{
+    snprintf(out, outSize, "unknown-cpu");
+
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (!f) return;
+
+    char line[TUNE_LINE];
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "model name", 10) == 0) {
+            char *v = strchr(line, ':');
+            if (v) {
+                v++;
+                while (*v == ' ' || *v == '\t') v++;
+                v[strcspn(v, "\n")] = '\0';
+                snprintf(out, outSize, "%s", v);
+            }
+            break;
+        }
+    }
+    fclose(f);
+
+    // keep the value a valid JSON string
+    for (char *c = out; *c; c++) {
+        if (*c == '"' || *c == '\\') *c = '\'';
+    }
+}
+
+// mkdir -p for the directory part of 'path'
+static void makeParentDirs(const char *path)
+{
+    char dir[TUNE_LINE];
+    snprintf(dir, sizeof(dir), "%s", path);
+    for (char *p = dir + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "autotune: cannot create %s\n", dir);
+            return;
+        }
+        *p = '/';
+    }
+}
+
+static void tuneFilePath(char *out, size_t outSize)
+{
+    const char *env = getenv("MATTRANSPOSE_TUNE_FILE");
+    if (env && *env) {
+        snprintf(out, outSize, "%s", env);
+        return;
+    }
+
+    const char *xdg  = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    if (xdg && *xdg) {
+        snprintf(out, outSize, "%s/mattranspose/tune.json", xdg);
+    } else {
+        snprintf(out, outSize, "%s/.cache/mattranspose/tune.json", (home && *home) ? home : ".");
+    }
+}
+
+/*****************************************************************************
+ * Tuning file: one JSON object per line inside "entries"
+ *****************************************************************************/
+
+static const char *jsonValue(const char *line, const char *key)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p = strstr(line, pattern);
+    if (!p) return NULL;
+    p += strlen(pattern);
+    while (*p == ' ') p++;
+    return p;
+}
+
+static int jsonInt(const char *line, const char *key, int *out)
+{
+    const char *p = jsonValue(line, key);
+    return p && sscanf(p, "%d", out) == 1;
+}
+
+static int jsonString(const char *line, const char *key, char *out, size_t outSize)
+{
+    const char *p = jsonValue(line, key);
+    if (!p || *p != '"') return 0;
+    p++;
+    const char *end = strchr(p, '"');
+    if (!end) return 0;
+    size_t len = (size_t)(end - p);
+    if (len >= outSize) len = outSize - 1;
+    memcpy(out, p, len);
+    out[len] = '\0';
+    return 1;
+}
+
+// Entries written before element types existed have no "type"; they were
+// tuned on floats.
+static int entryMatches(const char *line, const char *cpu, const char *method, const char *type,
+                        int rows, int cols, int threads, int inPlace)
+{
+    char s[TUNE_LINE];
+    int v;
+    if (!jsonString(line, "type", s, sizeof(s))) snprintf(s, sizeof(s), "float");
+    return strcmp(s, type) == 0
+        && jsonString(line, "cpu", s, sizeof(s))    && strcmp(s, cpu) == 0
+        && jsonString(line, "method", s, sizeof(s)) && strcmp(s, method) == 0
+        && jsonInt(line, "rows", &v)    && v == rows
+        && jsonInt(line, "cols", &v)    && v == cols
+        && jsonInt(line, "threads", &v) && v == threads
+        && jsonInt(line, "inplace", &v) && v == inPlace;
+}
+
+// Reads every entry line of the tuning file (trailing commas stripped).
+static int readEntries(const char *path, char entries[][TUNE_LINE], int maxEntries)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+
+    int count = 0;
+    char line[TUNE_LINE];
+    while (count < maxEntries && fgets(line, sizeof(line), f)) {
+        if (!strstr(line, "\"method\"")) continue;
+        char *end = line + strcspn(line, "\n");
+        *end = '\0';
+        while (end > line && (end[-1] == ',' || end[-1] == ' ')) *--end = '\0';
+        snprintf(entries[count++], TUNE_LINE, "%s", line);
+    }
+    fclose(f);
+    return count;
+}
+
+static void writeEntries(const char *path, char entries[][TUNE_LINE], int count)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "autotune: cannot write %s\n", path);
+        return;
+    }
+    fprintf(f, "{\n  \"entries\": [\n");
+    for (int e = 0; e < count; e++) {
+        fprintf(f, "%s%s\n", entries[e], (e + 1 < count) ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+}
+
+/*****************************************************************************
+ * Timed sweep
+ *****************************************************************************/
+
+static void runTranspose(const char *method, int inPlace, void *matrix, void *scratch,
+                         int rows, int cols, int blockSize)
+{
+    int omp = (strcmp(method, "omp") == 0);
+
+    if (inPlace) {
+        if (omp) matTransposeInPlaceRectOMP(matrix, rows, cols, blockSize);
+        else     matTransposeInPlaceRect(matrix, rows, cols, blockSize);
+    } else {
+        if (omp) matTransposeOMPRect(matrix, scratch, rows, cols, blockSize);
+        else     matTransposeBlockRect(matrix, scratch, rows, cols, blockSize);
+    }
+}
+
+static double timeTranspose(const char *method, int inPlace, void *matrix, void *scratch,
+                            int rows, int cols, int blockSize)
+{
+    double best = 1e30;
+    for (int rep = 0; rep < TUNE_REPS; rep++) {
+        double t0 = omp_get_wtime();
+        runTranspose(method, inPlace, matrix, scratch, rows, cols, blockSize);
+        double t = omp_get_wtime() - t0;
+        if (inPlace) {
+            // second pass restores 'matrix' (shape swaps back as well)
+            runTranspose(method, inPlace, matrix, scratch, cols, rows, blockSize);
+        }
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+static double timeCheck(const char *method, void *symmetric, int n, int blockSize)
+{
+    double best = 1e30;
+    for (int rep = 0; rep < TUNE_REPS; rep++) {
+        double t0 = omp_get_wtime();
+        if (strcmp(method, "omp") == 0) checkSymOMP(symmetric, n, blockSize);
+        else                            checkSymBlock(symmetric, n, blockSize);
+        double t = omp_get_wtime() - t0;
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+static void sweep(const char *method, int inPlace, void *matrix, void *scratch,
+                  int rows, int cols, TuneResult *result)
+{
+    const char *kernels[8];
+    int kernelCount = transposeKernelNames(kernels, 8);
+    int maxDim = (rows > cols) ? rows : cols;
+
+    result->seconds = 1e30;
+    result->blockSize = 64;
+    snprintf(result->kernel, sizeof(result->kernel), "%s", transposeKernelName());
+
+    // transpose: every block size x every tile kernel
+    for (int k = 0; k < kernelCount; k++) {
+        setTransposeKernel(kernels[k]);
+        for (int b = 0; b < tuneBlockCount; b++) {
+            int bs = tuneBlockSizes[b];
+            if (bs > maxDim && b > 0) break;
+
+            double t = timeTranspose(method, inPlace, matrix, scratch, rows, cols, bs);
+            if (t < result->seconds) {
+                result->seconds = t;
+                result->blockSize = bs;
+                snprintf(result->kernel, sizeof(result->kernel), "%s", kernels[k]);
+            }
+        }
+    }
+    setTransposeKernel(result->kernel);
+
+    // symmetry check: needs a symmetric input, otherwise it returns at the
+    // first mismatch; mirror the upper triangle of scratch into the lower one
+    result->checkBlockSize = result->blockSize;
+    if (scratch != NULL && rows == cols) {
+        int n = rows;
+        size_t es = elementBytes();
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < i; j++) {
+                memcpy(ELEM(scratch, (size_t)i * n + j), ELEM(scratch, (size_t)j * n + i), es);
+            }
+        }
+        double bestCheck = 1e30;
+        for (int b = 0; b < tuneBlockCount; b++) {
+            int bs = tuneBlockSizes[b];
+            if (bs > n && b > 0) break;
+
+            double t = timeCheck(method, scratch, n, bs);
+            if (t < bestCheck) {
+                bestCheck = t;
+                result->checkBlockSize = bs;
+            }
+        }
+    }
+}
+
+void autotune(const char *method, int inPlace, void *matrix, void *scratch,
+              int rows, int cols, TuneResult *result)
+{
+    char cpu[128];
+    char path[TUNE_LINE];
+    cpuModel(cpu, sizeof(cpu));
+    tuneFilePath(path, sizeof(path));
+
+    int threads = (strcmp(method, "omp") == 0) ? omp_get_max_threads() : 1;
+    const char *type = elementTypeName(elementType());
+
+    static char entries[TUNE_MAX_ENTRIES][TUNE_LINE];
+    int count = readEntries(path, entries, TUNE_MAX_ENTRIES);
+
+    // 1) cached result for this key?
+    for (int e = 0; e < count; e++) {
+        if (!entryMatches(entries[e], cpu, method, type, rows, cols, threads, inPlace)) continue;
+
+        if (jsonInt(entries[e], "block", &result->blockSize)
+            && jsonInt(entries[e], "check_block", &result->checkBlockSize)
+            && jsonString(entries[e], "kernel", result->kernel, sizeof(result->kernel))
+            && setTransposeKernel(result->kernel)) {
+            result->seconds = 0.0;
+            result->fromCache = 1;
+            return;
+        }
+    }
+
+    // 2) measure, then store (replacing a stale entry for the same key)
+    sweep(method, inPlace, matrix, scratch, rows, cols, result);
+    result->fromCache = 0;
+
+    int slot = count;
+    for (int e = 0; e < count; e++) {
+        if (entryMatches(entries[e], cpu, method, type, rows, cols, threads, inPlace)) {
+            slot = e;
+            break;
+        }
+    }
+    if (slot == TUNE_MAX_ENTRIES) {
+        slot = TUNE_MAX_ENTRIES - 1;  // file full: overwrite the newest entry
+    }
+    snprintf(entries[slot], TUNE_LINE,
+             "    {\"cpu\": \"%s\", \"method\": \"%s\", \"type\": \"%s\", \"rows\": %d, \"cols\": %d, "
+             "\"threads\": %d, \"inplace\": %d, \"block\": %d, \"check_block\": %d, "
+             "\"kernel\": \"%s\", \"seconds\": %.6f}",
+             cpu, method, type, rows, cols, threads, inPlace,
+             result->blockSize, result->checkBlockSize, result->kernel, result->seconds);
+    if (slot == count) count++;
+
+    makeParentDirs(path);
+    writeEntries(path, entries, count);
+}
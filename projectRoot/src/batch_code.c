@@ -0,0 +1,226 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include "matrix_operations.h"
+#include "mpi_common.h"
+#include "simd_kernels.h"
+#include "matrix_alloc.h"
+
+/*
+ A batch is either an array of matrix pointers or one buffer holding the
+ matrices at a fixed stride (in elements); matrix k of either kind.
+ */
+typedef struct {
+    void *const *mats;  // NULL for a strided batch
+    char        *base;
+    long         stride;
+} BatchRef;
+
+static inline char *batchMatrix(const BatchRef *ref, long k)
+{
+    return ref->mats ? (char *)ref->mats[k]
+                     : ref->base + (size_t)k * ref->stride * elementBytes();
+}
+
+/*
+ Transposes matrices [first, first + count) of 'in' into the same entries
+ of 'out' on the calling rank's OpenMP threads. The work items are bands of
+ blockSize rows of every matrix, so a batch of a few large matrices still
+ keeps every thread busy, while small matrices are one item each and the
+ loop hands them out in chunks rather than one by one.
+ */
+static void transposeBatchRange(const BatchRef *in, const BatchRef *out, int first, int count,
+                                int rows, int cols, int blockSize)
+{
+    if (count <= 0 || rows <= 0 || cols <= 0) return;
+    if (blockSize <= 0) blockSize = 64;
+
+    size_t es = elementBytes();
+    int bands = (rows + blockSize - 1) / blockSize;
+    long items = (long)count * bands;
+    long chunk = items / ((long)omp_get_max_threads() * 8);
+    if (chunk < 1) chunk = 1;
+
+#pragma omp parallel for default(none) \
+        shared(in, out, first, rows, cols, blockSize, es, bands, items, chunk) \
+        schedule(dynamic, chunk)
+    for (long t = 0; t < items; t++) {
+        long k = first + t / bands;
+        int i0 = (int)(t % bands) * blockSize;
+        int h = (rows - i0 < blockSize) ? rows - i0 : blockSize;
+
+        const char *src = batchMatrix(in, k) + (size_t)i0 * cols * es;
+        char *dst = batchMatrix(out, k) + (size_t)i0 * es;
+        transposeBlocked(src, cols, dst, rows, h, cols, blockSize);
+    }
+}
+
+void matTransposeBatch(void **mats, void **outs, int count, int n, int blockSize)
+{
+    matTransposeBatchRect(mats, outs, count, n, n, blockSize);
+}
+
+void matTransposeBatchRect(void **mats, void **outs, int count, int rows, int cols,
+                           int blockSize)
+{
+    BatchRef in  = { mats, NULL, 0 };
+    BatchRef out = { outs, NULL, 0 };
+    transposeBatchRange(&in, &out, 0, count, rows, cols, blockSize);
+}
+
+void matTransposeBatchStrided(const void *mats, long strideIn, void *outs, long strideOut,
+                              int count, int rows, int cols, int blockSize)
+{
+    BatchRef in  = { NULL, (char *)mats, strideIn };
+    BatchRef out = { NULL, (char *)outs, strideOut };
+    transposeBatchRange(&in, &out, 0, count, rows, cols, blockSize);
+}
+
+// First matrix of rank r when 'count' matrices are dealt out in balanced
+// consecutive runs.
+static int batchStart(int count, int size, int r)
+{
+    return r * (count / size) + ((r < count % size) ? r : count % size);
+}
+
+/*
+ The matrices [first, first + n) of a batch on rank 0 as one type over
+ MPI_BOTTOM: their absolute addresses, one 'matrixType' each. Pointer
+ batches can be scattered anywhere in memory, so this is what lets one
+ collective move all of them without packing.
+ */
+static MPI_Datatype createBatchType(const BatchRef *ref, int first, int n,
+                                    MPI_Datatype matrixType)
+{
+    MPI_Aint *displs = (MPI_Aint *)malloc((size_t)n * sizeof(MPI_Aint));
+    for (int k = 0; k < n; k++) {
+        MPI_Get_address(batchMatrix(ref, first + k), &displs[k]);
+    }
+
+    MPI_Datatype type;
+    MPI_Type_create_hindexed_block(n, 1, displs, matrixType, &type);
+    MPI_Type_commit(&type);
+    free(displs);
+    return type;
+}
+
+/*
+ Batched transpose across ranks. Rank 0 holds the whole batch; every rank
+ gets a run of whole matrices, so no matrix is ever split and no exchange
+ between ranks is needed. The scatter and the gather are one MPI_Alltoallw
+ each, whose rank-0 side is a per-rank hindexed type over the matrices'
+ own addresses (no packing on rank 0), and the scatter is nonblocking:
+ rank 0 transposes its own run straight from 'in' to 'out' while the other
+ runs are on their way.
+ */
+static void transposeBatchMPI(const BatchRef *in, const BatchRef *out, int count,
+                              int rows, int cols, int blockSize)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (size == 1) {
+        transposeBatchRange(in, out, 0, count, rows, cols, blockSize);
+        return;
+    }
+
+    // one matrix; rows x cols and its cols x rows transpose have the same size
+    MPI_Datatype rowType, matrixType;
+    MPI_Type_contiguous(cols, elementMPIType(), &rowType);
+    MPI_Type_contiguous(rows, rowType, &matrixType);
+    MPI_Type_commit(&matrixType);
+    MPI_Type_free(&rowType);
+
+    int first = batchStart(count, size, rank);
+    int localCount = batchStart(count, size, rank + 1) - first;
+
+    int *counts0 = (int *)calloc(size, sizeof(int));
+    int *counts1 = (int *)calloc(size, sizeof(int));
+    int *displs  = (int *)calloc(size, sizeof(int));
+    MPI_Datatype *types0 = (MPI_Datatype *)malloc(size * sizeof(MPI_Datatype));
+    MPI_Datatype *types1 = (MPI_Datatype *)malloc(size * sizeof(MPI_Datatype));
+    for (int r = 0; r < size; r++) {
+        types0[r] = types1[r] = matrixType;
+    }
+
+    // ---- 1) rank 0: one batch type per rank for the input and the output
+    MPI_Datatype *inTypes = NULL, *outTypes = NULL;
+    if (rank == 0) {
+        inTypes  = (MPI_Datatype *)malloc(size * sizeof(MPI_Datatype));
+        outTypes = (MPI_Datatype *)malloc(size * sizeof(MPI_Datatype));
+        for (int r = 1; r < size; r++) {
+            int rFirst = batchStart(count, size, r);
+            int rCount = batchStart(count, size, r + 1) - rFirst;
+            inTypes[r]  = createBatchType(in, rFirst, rCount, matrixType);
+            outTypes[r] = createBatchType(out, rFirst, rCount, matrixType);
+            counts0[r]  = 1;
+        }
+    }
+
+    // ---- 2) scatter the runs; rank 0 transposes its own meanwhile
+    size_t localBytes = (size_t)localCount * rows * cols * elementBytes();
+    void *localM = (rank != 0) ? matrixAlloc(localBytes, "batch local M") : NULL;
+    void *localT = (rank != 0) ? matrixAlloc(localBytes, "batch local T") : NULL;
+    MPI_Request request;
+    if (rank == 0) {
+        for (int r = 1; r < size; r++) types0[r] = inTypes[r];
+        MPI_Ialltoallw(MPI_BOTTOM, counts0, displs, types0,
+                       NULL, counts1, displs, types1, MPI_COMM_WORLD, &request);
+        transposeBatchRange(in, out, 0, localCount, rows, cols, blockSize);
+    } else {
+        counts1[0] = localCount;
+        MPI_Ialltoallw(NULL, counts0, displs, types0,
+                       localM, counts1, displs, types1, MPI_COMM_WORLD, &request);
+    }
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+
+    // ---- 3) everyone else transposes its run, strided and contiguous
+    if (rank != 0) {
+        BatchRef localIn  = { NULL, (char *)localM, (long)rows * cols };
+        BatchRef localOut = { NULL, (char *)localT, (long)rows * cols };
+        transposeBatchRange(&localIn, &localOut, 0, localCount, rows, cols, blockSize);
+    }
+
+    // ---- 4) gather the transposes straight into rank 0's output matrices
+    if (rank == 0) {
+        for (int r = 1; r < size; r++) types1[r] = outTypes[r];
+        MPI_Alltoallw(NULL, counts1, displs, types0,
+                      MPI_BOTTOM, counts0, displs, types1, MPI_COMM_WORLD);
+        for (int r = 1; r < size; r++) {
+            MPI_Type_free(&inTypes[r]);
+            MPI_Type_free(&outTypes[r]);
+        }
+    } else {
+        MPI_Alltoallw(localT, counts1, displs, types0,
+                      NULL, counts0, displs, types1, MPI_COMM_WORLD);
+    }
+
+    free(inTypes);
+    free(outTypes);
+    matrixFree(localM);
+    matrixFree(localT);
+    free(counts0);
+    free(counts1);
+    free(displs);
+    free(types0);
+    free(types1);
+    MPI_Type_free(&matrixType);
+}
+
+void matTransposeBatchMPI(void **mats, void **outs, int count, int rows, int cols,
+                          int blockSize)
+{
+    BatchRef in  = { mats, NULL, 0 };
+    BatchRef out = { outs, NULL, 0 };
+    transposeBatchMPI(&in, &out, count, rows, cols, blockSize);
+}
+
+void matTransposeBatchStridedMPI(const void *mats, long strideIn, void *outs, long strideOut,
+                                 int count, int rows, int cols, int blockSize)
+{
+    BatchRef in  = { NULL, (char *)mats, strideIn };
+    BatchRef out = { NULL, (char *)outs, strideOut };
+    transposeBatchMPI(&in, &out, count, rows, cols, blockSize);
+}
@@ -6,44 +6,477 @@
 
 #include "utils.h"
 #include "matrix_operations.h"
+#include "matrix_io.h"
+#include "simd_kernels.h"
+#include "autotune.h"
+#include "transpose_plan.h"
+#include "numa_placement.h"
+#include "matrix_alloc.h"
 
-int main(int argc, char *argv[])
+/*
+ --alloc-report: rank 0's buffers one by one, then the huge page share of
+ what all ranks allocated. Collective.
+ */
+static void printAllocReport(int rank)
 {
-    MPI_Init(&argc, &argv);  // Initialize MPI
+    size_t bytes, hugeBytes;
+    matrixAllocTotals(&bytes, &hugeBytes);
+    double local[2] = { (double)bytes, (double)hugeBytes }, total[2];
+    MPI_Reduce(local, total, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        matrixAllocReport();
+        printf("   All ranks: %.2f MiB allocated, %.1f%% on huge pages\n", total[0] / 1048576.0,
+               total[0] ? 100.0 * total[1] / total[0] : 0.0);
+    }
+}
 
+/*
+ -m batch / mpi_batch: transposes 'count' rows x cols matrices (matrix k is
+ generated from seed + k) with one batched call, on rank 0's threads or
+ spread over all ranks, and reports the throughput in matrices per second.
+ */
+static int runBatch(const char *method, int count, int rows, int cols, int blockSize,
+                    int seed, int doChecksum, int display)
+{
     int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    int useMPI = strcmp(method, "mpi_batch") == 0;
+
+    size_t matrixBytes = (size_t)rows * cols * elementBytes();
+    char *in = NULL, *out = NULL;
+    void **mats = NULL, **outs = NULL;
+    if (rank == 0) {
+        in   = (char *)matrixAlloc(count * matrixBytes, "batch M");
+        out  = (char *)matrixAlloc(count * matrixBytes, "batch T");
+        mats = (void **)malloc(count * sizeof(void *));
+        outs = (void **)malloc(count * sizeof(void *));
+        if (!in || !out || !mats || !outs) {
+            fprintf(stderr, "Cannot allocate a batch of %d %d x %d matrices.\n", count, rows, cols);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        for (int k = 0; k < count; k++) {
+            mats[k] = in + k * matrixBytes;
+            outs[k] = out + k * matrixBytes;
+            initializeMatrixRect(mats[k], rows, cols, seed + k);
+        }
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
+    if (useMPI) {
+        matTransposeBatchMPI(mats, outs, count, rows, cols, blockSize);
+    } else if (rank == 0) {
+        matTransposeBatchRect(mats, outs, count, rows, cols, blockSize);
+    }
+    double batchTime = MPI_Wtime() - start;
+
+    if (rank == 0) {
+        float originalCheck = 0.0f, transposedCheck = 0.0f;
+        if (doChecksum) {
+            for (int k = 0; k < count; k++) {
+                originalCheck   += partialChecksumRect(mats[k], rows, cols);
+                transposedCheck += partialChecksumRect(outs[k], cols, rows);
+            }
+        }
+
+        int nprocs;
+        MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+        if (useMPI) {
+            printf("   Ranks x threads: %d x %d\n", nprocs, omp_get_max_threads());
+        }
+        printf("   Batch: %d matrices of %d x %d\n", count, rows, cols);
+        printf("   Transpose time: %.6f s\n", batchTime);
+        printf("   Matrices per second: %.1f\n", batchTime > 0.0 ? count / batchTime : 0.0);
+        if (doChecksum) {
+            printf("   Partial checksum (original)   = %f\n", originalCheck);
+            printf("   Partial checksum (transposed) = %f\n", transposedCheck);
+        }
+        if (display && count > 0) {
+            printf("Transposed matrix 0:\n");
+            printMatrixRect(outs[0], cols, rows);
+        }
+    }
+
+    matrixFree(in);
+    matrixFree(out);
+    free(mats);
+    free(outs);
+    if (allocReportEnabled()) {
+        printAllocReport(rank);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    // Hybrid MPI+OpenMP: only the master thread of each rank calls MPI
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int rank, nprocs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    if (provided < MPI_THREAD_FUNNELED && rank == 0) {
+        fprintf(stderr, "Warning: MPI library lacks MPI_THREAD_FUNNELED, "
+                        "run with OMP_NUM_THREADS=1\n");
+    }
+
+    // Pick the widest register-tile transpose kernel this CPU supports
+    initTransposeKernels();
 
     // Default parameters
     int n = 4096;
+    int rows = 0, cols = 0;      // --rows/--cols for a non-square rows x cols matrix
     int blockSize = 64;
-    char method[50] = "serialblock";  // serial, serialblock, omp, mpi, mpi_blocks
+    int autoTune = 0;            // -b auto: tuned block sizes, see autotune.h
+    char method[50] = "serialblock";  // serialblock, omp, recursive, recursive_omp, ooc, batch, mpi*, mpi_blocks*, mpi_blockcyclic, mpi_batch, mpi_shm
     int display = 0;             // Whether to print the final transposed matrix
     int doChecksum = 1;          // Whether to compute partial checksums
+    int inPlace = 0;             // Overwrite 'matrix' instead of filling 'transposed'
+    int distOutput = 0;          // MPI methods: leave the result sharded, skip the gather
+    int collect = 0;             // with distOutput: gather it afterwards in a timed step
+    int localInit = 0;           // MPI methods: every rank generates its own part of M
+    int symmetric = 0;           // generate a symmetric M (exercises the skip path)
+    int seed = 321;              // fixed seed
+    int slabAlign = 1;           // row methods: round slab boundaries to this many rows
+    const char *inputPath  = NULL;   // read M from this raw or binary matrix file
+    const char *outputPath = NULL;   // write T to this file (MPI-IO for raw/row)
+    int outputOrder = -1;        // --format: -1 raw, else ORDER_* of a binary matrix file
+    int fileTile = 256;          // --tile: tiled layout / checksum tile edge
+    long memBudgetMiB = 256;     // ooc: memory the mapped tiles may occupy
+    const char *typeName = "float";  // -t: element type, see simd_kernels.h
+    int batchCount = 1000;       // batch, mpi_batch: matrices per batch
+    int planReps = 0;            // --plan: execute a transpose plan this many times
+    int numa = 0;                // --numa: pinned threads, first-touch placement of M and T
+    const char *hugePages = "thp";   // --hugepages: thp, hugetlb or off, see matrix_alloc.h
 
     // Parse command-line arguments
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
             n = atoi(argv[++i]);
         } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
-            blockSize = atoi(argv[++i]);
+            if (strcmp(argv[++i], "auto") == 0) {
+                autoTune = 1;
+            } else {
+                blockSize = atoi(argv[i]);
+            }
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            typeName = argv[++i];
         } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
             strncpy(method, argv[++i], 49);
         } else if (strcmp(argv[i], "-d") == 0) {
             display = 1;
         } else if (strcmp(argv[i], "-c") == 0) {
             doChecksum = 1;
+        } else if (strcmp(argv[i], "--inplace") == 0) {
+            inPlace = 1;
+        } else if (strcmp(argv[i], "--distributed-output") == 0) {
+            distOutput = 1;
+        } else if (strcmp(argv[i], "--collect") == 0) {
+            collect = 1;
+        } else if (strcmp(argv[i], "--local-init") == 0) {
+            localInit = 1;
+        } else if (strcmp(argv[i], "--symmetric") == 0) {
+            symmetric = 1;
+        } else if (strcmp(argv[i], "--slab-align") == 0 && i + 1 < argc) {
+            slabAlign = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+            inputPath = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            i++;
+            if      (strcmp(argv[i], "raw") == 0)   outputOrder = -1;
+            else if (strcmp(argv[i], "row") == 0)   outputOrder = ORDER_ROW_MAJOR;
+            else if (strcmp(argv[i], "col") == 0)   outputOrder = ORDER_COL_MAJOR;
+            else if (strcmp(argv[i], "tiled") == 0) outputOrder = ORDER_TILED;
+            else                                    outputOrder = -2;
+        } else if (strcmp(argv[i], "--tile") == 0 && i + 1 < argc) {
+            fileTile = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--numa") == 0) {
+            numa = 1;
+        } else if (strcmp(argv[i], "--hugepages") == 0 && i + 1 < argc) {
+            hugePages = argv[++i];
+        } else if (strcmp(argv[i], "--alloc-report") == 0) {
+            setAllocReport(1);
+        } else if (strcmp(argv[i], "--plan") == 0 && i + 1 < argc) {
+            planReps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batchCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--mem-budget") == 0 && i + 1 < argc) {
+            memBudgetMiB = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--rows") == 0 && i + 1 < argc) {
+            rows = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cols") == 0 && i + 1 < argc) {
+            cols = atoi(argv[++i]);
+        }
+    }
+
+    // Square n x n unless --rows/--cols say otherwise
+    if (rows <= 0) rows = n;
+    if (cols <= 0) cols = n;
+
+    if (!setElementType(typeName)) {
+        if (rank == 0) {
+            fprintf(stderr, "Unknown element type '%s' (use float, double, i8, i16, i32 "
+                            "or c64).\n", typeName);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    if (!setHugePages(hugePages)) {
+        if (rank == 0) {
+            fprintf(stderr, "--hugepages must be thp, hugetlb or off.\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    // A binary matrix file brings its own dimensions and element type
+    MatrixFileHeader inHeader;
+    int inputHeader = 0;
+    if (inputPath) {
+        if (rank == 0) inputHeader = matrixFileProbe(inputPath, &inHeader);
+        MPI_Bcast(&inputHeader, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&inHeader, sizeof inHeader, MPI_BYTE, 0, MPI_COMM_WORLD);
+        if (inputHeader < 0) {
+            MPI_Finalize();
+            return 1;
+        }
+        if (inputHeader) {
+            rows = (int)inHeader.rows;
+            cols = (int)inHeader.cols;
+            setElementType(elementTypeName((ElemType)inHeader.elemType));
+        }
+    }
+    if (outputOrder < -1 || fileTile <= 0 || fileTile > MATRIX_FILE_MAX_TILE) {
+        if (rank == 0) {
+            fprintf(stderr, "--format must be raw, row, col or tiled and --tile in 1..%d.\n",
+                    MATRIX_FILE_MAX_TILE);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    int isRect = (rows != cols);
+    if (!isRect) n = rows;
+    int checkBlockSize = blockSize;  // may differ from blockSize after -b auto
+
+    // In-place kernels exist for serialblock, omp and mpi3 only
+    if (inPlace && strcmp(method, "serialblock") != 0 && strcmp(method, "omp") != 0
+                && strcmp(method, "mpi3") != 0) {
+        if (rank == 0) {
+            fprintf(stderr, "--inplace is not supported for method '%s' "
+                            "(use serialblock, omp or mpi3).\n", method);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    if (inPlace && isRect && strcmp(method, "mpi3") == 0) {
+        if (rank == 0) {
+            fprintf(stderr, "--inplace with --rows/--cols is only supported "
+                            "for serialblock and omp.\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Distributed output exists for the MPI methods only
+    int shmMethod = strcmp(method, "mpi_shm") == 0;  // T is already all on rank 0's node
+    if (distOutput && (strncmp(method, "mpi", 3) != 0 || inPlace || shmMethod
+                       || strcmp(method, "mpi_blockcyclic") == 0)) {
+        if (rank == 0) {
+            fprintf(stderr, "--distributed-output needs an MPI method (mpi, mpi2, mpi3, "
+                            "mpi4, mpi_blocks1, mpi_blocks3) and no --inplace.\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    if (inputPath && (localInit || symmetric)) {
+        if (rank == 0) {
+            fprintf(stderr, "--input cannot be combined with --local-init or --symmetric.\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+
+    // Out-of-core: file to file on rank 0, nothing is held in memory
+    int outOfCore = strcmp(method, "ooc") == 0;
+    if (outOfCore && (!inputPath || !outputPath || memBudgetMiB <= 0 || outputOrder != -1
+                      || (inputHeader && inHeader.order != ORDER_ROW_MAJOR))) {
+        if (rank == 0) {
+            fprintf(stderr, "-m ooc needs --input (raw or row-major), --output (raw) "
+                            "and a positive --mem-budget.\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Batches of small matrices: generated, timed and checked in runBatch
+    if (strcmp(method, "batch") == 0 || strcmp(method, "mpi_batch") == 0) {
+        if (batchCount <= 0 || inPlace || distOutput || localInit || symmetric
+            || inputPath || outputPath) {
+            if (rank == 0) {
+                fprintf(stderr, "-m %s needs a positive --batch and no --inplace, "
+                                "--distributed-output, --local-init, --symmetric, --input "
+                                "or --output.\n", method);
+            }
+            MPI_Finalize();
+            return 1;
+        }
+        int status = runBatch(method, batchCount, rows, cols, blockSize, seed, doChecksum, display);
+        MPI_Finalize();
+        return status;
+    }
+
+    // Column-major and tiled files are written from all of T on rank 0
+    int wholeOutput = (outputOrder == ORDER_COL_MAJOR || outputOrder == ORDER_TILED);
+    if (wholeOutput && distOutput && !collect) {
+        if (rank == 0) {
+            fprintf(stderr, "--format col/tiled needs --collect with --distributed-output.\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    // With --output the methods that can leave T sharded write it straight
+    // from the ranks, so the gather disappears (a plan keeps its T on rank 0)
+    int hasDist = strncmp(method, "mpi", 3) == 0 && strcmp(method, "mpi_blockcyclic") != 0
+                  && !shmMethod;
+    if (outputPath && hasDist && !inPlace && !wholeOutput && planReps == 0) {
+        distOutput = 1;
+    }
+    int haveResult = (!distOutput || collect) && !outOfCore;  // rank 0 ends up with all of T
+
+    // Local generation replaces the scatter of the MPI methods
+    if (localInit && (strncmp(method, "mpi", 3) != 0 || inPlace)) {
+        if (rank == 0) {
+            fprintf(stderr, "--local-init needs an MPI method and no --inplace.\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    if (symmetric && isRect) {
+        if (rank == 0) {
+            fprintf(stderr, "--symmetric needs a square matrix.\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    if (localInit) {
+        setLocalInit(seed, symmetric);
+    }
+    setSlabAlign(slabAlign);
+
+    // With --input the MPI methods read their own parts of the file with
+    // MPI-IO, tiled and column-major payloads included (mpi_blockcyclic's
+    // darray view needs row-major); everything else gets all of M on
+    // rank 0, binary matrix files through the checksum-verifying loader
+    int localSource = localInit || outOfCore;
+    int mpiMethod = strncmp(method, "mpi", 3) == 0 && !inPlace;
+    int inputOrder = inputHeader ? (int)inHeader.order : ORDER_ROW_MAJOR;
+    int inputTile  = inputHeader ? (int)inHeader.tileSize : 0;
+    long inputOffset = inputHeader ? (long)inHeader.dataOffset : 0;
+    if (inputPath && !outOfCore) {
+        if (!inputHeader || (mpiMethod && (inputOrder == ORDER_ROW_MAJOR
+                                           || strcmp(method, "mpi_blockcyclic") != 0))) {
+            setInputFile(inputPath, rows, cols, inputHeader ? &inHeader : NULL);
+        }
+        localSource = mpiMethod && inputFileEnabled();
+    }
+
+    // A plan is bound to M and T on rank 0, see transpose_plan.h
+    if (planReps > 0 && (inPlace || distOutput || localSource
+                         || (strcmp(method, "serialblock") != 0 && strcmp(method, "omp") != 0
+                             && strcmp(method, "mpi4") != 0))) {
+        if (rank == 0) {
+            fprintf(stderr, "--plan needs serialblock, omp or mpi4 with M on rank 0 (no "
+                            "--inplace, --distributed-output, --local-init or MPI --input).\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    // NUMA placement follows the static tile mapping of matTransposeOMPRect
+    if (numa && (strcmp(method, "omp") != 0 || inPlace)) {
+        if (rank == 0) {
+            fprintf(stderr, "--numa needs -m omp and no --inplace.\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    if (numa && rank == 0) {
+        setNumaPlacement(1);
+        pinThreads();
+    }
+
+    // mpi_shm: M and T live once per node in shared windows, see matrix_operations.h
+    ShmMatrices *shm = NULL;
+    if (shmMethod) {
+        shm = shmMatricesCreate(rows, cols);
+        if (!shm) {
+            MPI_Finalize();
+            return 1;
         }
     }
 
     // Allocate memory (rank 0 for MPI has the full matrix)
-    float *matrix     = NULL;
-    float *transposed = NULL;
-    if (rank == 0) {
-        matrix     = (float *)malloc(n * n * sizeof(float));
-        transposed = (float *)malloc(n * n * sizeof(float));
-        initializeMatrix(matrix, n, 321); // fixed seed
-        //initializeSymmetricMatrix(matrix, n, 123); // symmetric matrix
+    // In-place mode skips the second buffer; 'transposed' aliases 'matrix'
+    // Distributed output without --collect never needs it on rank 0,
+    // local init and --input never need 'matrix'
+    void *matrix     = NULL;
+    void *transposed = NULL;
+    if (rank == 0 && shm) {
+        transposed = shmOutput(shm);
+        matrix     = shmInput(shm);
+        if (!localSource) {
+            if (symmetric)       initializeSymmetricMatrix(matrix, n, seed);
+            else if (!inputPath) initializeMatrixRect(matrix, rows, cols, seed);
+        }
+    }
+    else if (rank == 0) {
+        size_t bytes = (size_t)rows * cols * elementBytes();
+        transposed = haveResult ? matrixAlloc(bytes, inPlace ? "M/T" : "T") : NULL;
+        if (!localSource) {
+            matrix = inPlace ? transposed : matrixAlloc(bytes, "M");
+            if (numa)            firstTouchOMP(matrix, transposed, rows, cols, blockSize);
+            if (symmetric)       initializeSymmetricMatrix(matrix, n, seed);
+            else if (!inputPath) initializeMatrixRect(matrix, rows, cols, seed);
+        }
+    }
+    if (shm && localSource) {
+        shmLoadInput(shm);  // every rank its row slab, straight into shared M
+        if (inputFileEnabled()) closeInputFile();
+    }
+    else if (inputPath && !localSource) {
+        if (inputFileEnabled()) {
+            loadLocalBlock(matrix, cols, 0, 0, rank == 0 ? rows : 0, cols);
+            closeInputFile();
+        }
+        else if (rank == 0 && matrixFileRead(inputPath, matrix, rows, cols) != 0) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    if (numa && rank == 0) {
+        reportPlacement(matrix, transposed, rows, cols, blockSize);
+    }
+
+    // -b auto: reuse or measure the best block sizes for this method/shape/machine
+    if (autoTune && rank == 0) {
+        if (autotuneSupported(method)) {
+            TuneResult tune;
+            double tuneStart = MPI_Wtime();
+            autotune(method, inPlace, matrix, inPlace ? NULL : transposed, rows, cols, &tune);
+            blockSize      = tune.blockSize;
+            checkBlockSize = tune.checkBlockSize;
+            printf("   Autotune (%s): block=%d check-block=%d kernel=%s [%.3f s]\n",
+                   tune.fromCache ? "cached" : "measured", blockSize, checkBlockSize,
+                   tune.kernel, MPI_Wtime() - tuneStart);
+        } else {
+            printf("   Autotune: method '%s' has no block size to tune, using %d\n",
+                   method, blockSize);
+        }
     }
 
     // 1) Check if the matrix is symmetric BEFORE transposition
@@ -51,12 +484,22 @@ int main(int argc, char *argv[])
     int isSymBefore = -1; // valid on rank 0 or distributed result
 
     // Decide which check method to call
-    if (strcmp(method, "serialblock") == 0 && rank == 0) {
-        isSymBefore = checkSymBlock(matrix, n, blockSize);
+    // (a non-square matrix is never symmetric; ooc never reads M here)
+    if (isRect || outOfCore) {
+        isSymBefore = 0;
+    }
+    else if (strcmp(method, "serialblock") == 0 && rank == 0) {
+        isSymBefore = checkSymBlock(matrix, n, checkBlockSize);
     } 
     else if (strcmp(method, "omp") == 0 && rank == 0) {
-        isSymBefore = checkSymOMP(matrix, n);
+        isSymBefore = checkSymOMP(matrix, n, checkBlockSize);
     } 
+    else if (strcmp(method, "recursive") == 0 && rank == 0) {
+        isSymBefore = checkSymBlock(matrix, n, checkBlockSize);
+    }
+    else if (strcmp(method, "recursive_omp") == 0 && rank == 0) {
+        isSymBefore = checkSymOMP(matrix, n, checkBlockSize);
+    }
     else if (strcmp(method, "mpi") == 0) {
         isSymBefore = checkSymMPI(matrix, n);
     } 
@@ -66,6 +509,10 @@ int main(int argc, char *argv[])
     else if (strcmp(method, "mpi3") == 0) {
         isSymBefore = checkSymMPI3(matrix, n);
     }
+    else if (strcmp(method, "mpi4") == 0 || strcmp(method, "mpi_blockcyclic") == 0) {
+        // balanced row slabs, like mpi3
+        isSymBefore = checkSymMPI3(matrix, n);
+    }
     else if (strcmp(method, "mpi_blocks1") == 0) {
         //if (rank == 0) {printf("Entrato check sym");}
         isSymBefore = checkSymBlockMPI1(matrix, n);
@@ -76,33 +523,160 @@ int main(int argc, char *argv[])
         isSymBefore = checkSymBlockMPI3(matrix, n);
         //if (rank == 0) {printf("Uscito check sym");}
     }
+    else if (shm) {
+        isSymBefore = checkSymShm(shm, checkBlockSize);
+    }
     double symEnd = MPI_Wtime();
     double symTimeBefore = symEnd - symStart;
 
     // 2) compute partial checksum of original matrix
     float originalCheck = 0.0f;
     if (doChecksum && rank == 0) {
-        originalCheck = partialChecksum(matrix, n);
+        if (matrix)         originalCheck = partialChecksumRect(matrix, rows, cols);
+        else if (inputPath) originalCheck = partialChecksumFile(inputPath, inputOffset, rows, cols,
+                                                          inputOrder, inputTile);
+        else                originalCheck = partialChecksumGenerated(rows, cols, seed, symmetric);
     }
 
     // 3) Transpose timing
     double transposeTime = 0.0;  
+    double planTime = 0.0;
+    double collectTime = 0.0;
+    double writeTime = 0.0;
+    LocalPart part = { 0, 0, 0, 0, 0, NULL };  // our part of T with --distributed-output
 
-    // If the matrix is symmetric, skip transposition
-    if (isSymBefore == 0) {
+    // If the matrix is symmetric, skip transposition (unless T must be written)
+    int doTranspose = (isSymBefore == 0) || outputPath;
+    if (doTranspose) {
 
         double transposeStart = MPI_Wtime();
 
-        if (strcmp(method, "serialblock") == 0) {
+        if (planReps > 0) {
+            // set-up is timed on its own; the transpose time is per execution
+            TransposePlan *plan = transposePlanCreateRect(matrix, transposed, rows, cols, method,
+                                                          blockSize, MPI_COMM_WORLD);
+            planTime = MPI_Wtime() - transposeStart;
+            transposeStart = MPI_Wtime();
+            for (int r = 0; r < planReps; r++) {
+                transposePlanExecute(plan);
+            }
+            transposePlanDestroy(plan);
+        }
+        else if (distOutput) {
+            if (strcmp(method, "mpi") == 0) {
+                matTransposeMPIDist(matrix, rows, cols, &part);
+            }
+            else if (strcmp(method, "mpi2") == 0) {
+                matTransposeMPI2Dist(matrix, rows, cols, &part);
+            }
+            else if (strcmp(method, "mpi3") == 0) {
+                matTransposeMPI3Dist(matrix, rows, cols, &part);
+            }
+            else if (strcmp(method, "mpi4") == 0) {
+                matTransposeMPI4Dist(matrix, rows, cols, &part);
+            }
+            else if (strcmp(method, "mpi_blocks1") == 0) {
+                matTransposeBlockMPI1Dist(matrix, rows, cols, &part);
+            }
+            else if (strcmp(method, "mpi_blocks3") == 0) {
+                matTransposeBlockMPI3Dist(matrix, rows, cols, &part);
+            }
+            else if (rank == 0) {
+                fprintf(stderr, "Unknown method '%s'.\n", method);
+            }
+        }
+        else if (shm) {
+            matTransposeShm(shm, blockSize);
+        }
+        else if (outOfCore) {
+            if (rank == 0) {
+                matTransposeOutOfCore(inputPath, inputOffset, outputPath, rows, cols,
+                                      (size_t)memBudgetMiB << 20, blockSize);
+            }
+        }
+        else if (isRect) {
+            if (strcmp(method, "serialblock") == 0) {
+                if (rank == 0) {
+                    if (inPlace) matTransposeInPlaceRect(matrix, rows, cols, blockSize);
+                    else         matTransposeBlockRect(matrix, transposed, rows, cols, blockSize);
+                }
+            }
+            else if (strcmp(method, "omp") == 0) {
+                if (rank == 0) {
+                    if (inPlace) matTransposeInPlaceRectOMP(matrix, rows, cols, blockSize);
+                    else         matTransposeOMPRect(matrix, transposed, rows, cols, blockSize);
+                }
+            }
+            else if (strcmp(method, "recursive") == 0) {
+                if (rank == 0) {
+                    matTransposeRecursiveRect(matrix, transposed, rows, cols);
+                }
+            }
+            else if (strcmp(method, "recursive_omp") == 0) {
+                if (rank == 0) {
+                    matTransposeRecursiveOMPRect(matrix, transposed, rows, cols);
+                }
+            }
+            else if (strcmp(method, "mpi") == 0) {
+                matTransposeMPIRect(matrix, transposed, rows, cols);
+            }
+            else if (strcmp(method, "mpi2") == 0) {
+                matTransposeMPI2Rect(matrix, transposed, rows, cols);
+            }
+            else if (strcmp(method, "mpi3") == 0) {
+                matTransposeMPI3Rect(matrix, transposed, rows, cols);
+            }
+            else if (strcmp(method, "mpi4") == 0) {
+                matTransposeMPI4Rect(matrix, transposed, rows, cols);
+            }
+            else if (strcmp(method, "mpi_blocks1") == 0) {
+                matTransposeBlockMPI1Rect(matrix, transposed, rows, cols);
+            }
+            else if (strcmp(method, "mpi_blocks3") == 0) {
+                matTransposeBlockMPI3Rect(matrix, transposed, rows, cols);
+            }
+            else if (strcmp(method, "mpi_blockcyclic") == 0) {
+                matTransposeBlockCyclicMPIRect(matrix, transposed, rows, cols, blockSize);
+            }
+            else if (rank == 0) {
+                fprintf(stderr, "Unknown method '%s'.\n", method);
+            }
+        }
+        else if (inPlace) {
+            if (strcmp(method, "serialblock") == 0) {
+                if (rank == 0) {
+                    matTransposeInPlace(matrix, n, blockSize);
+                }
+            }
+            else if (strcmp(method, "omp") == 0) {
+                if (rank == 0) {
+                    matTransposeInPlaceOMP(matrix, n, blockSize);
+                }
+            }
+            else if (strcmp(method, "mpi3") == 0) {
+                matTransposeInPlaceMPI3(matrix, n);
+            }
+        }
+        else if (strcmp(method, "serialblock") == 0) {
             if (rank == 0) {
                 matTransposeBlock(matrix, transposed, n, blockSize);
             }
         } 
         else if (strcmp(method, "omp") == 0) {
             if (rank == 0) {
-                matTransposeOMP(matrix, transposed, n);
+                matTransposeOMP(matrix, transposed, n, blockSize);
             }
         } 
+        else if (strcmp(method, "recursive") == 0) {
+            if (rank == 0) {
+                matTransposeRecursive(matrix, transposed, n);
+            }
+        }
+        else if (strcmp(method, "recursive_omp") == 0) {
+            if (rank == 0) {
+                matTransposeRecursiveOMP(matrix, transposed, n);
+            }
+        }
         else if (strcmp(method, "mpi") == 0) {
             matTransposeMPI(matrix, transposed, n);
         } 
@@ -112,11 +686,17 @@ int main(int argc, char *argv[])
         else if (strcmp(method, "mpi3") == 0) {
             matTransposeMPI3(matrix, transposed, n);
         }
+        else if (strcmp(method, "mpi4") == 0) {
+            matTransposeMPI4(matrix, transposed, n);
+        }
         else if (strcmp(method, "mpi_blocks1") == 0) {
             matTransposeBlockMPI1(matrix, transposed, n); 
         }
         else if (strcmp(method, "mpi_blocks3") == 0) {
             matTransposeBlockMPI3(matrix, transposed, n); 
+        }
+        else if (strcmp(method, "mpi_blockcyclic") == 0) {
+            matTransposeBlockCyclicMPI(matrix, transposed, n, blockSize);
         }  
         else {
             if (rank == 0) {
@@ -126,6 +706,37 @@ int main(int argc, char *argv[])
 
         double transposeEnd = MPI_Wtime();
         transposeTime = transposeEnd - transposeStart;
+        if (planReps > 0) {
+            transposeTime /= planReps;
+        }
+
+        // optional, separately timed collection of the sharded result
+        if (distOutput && collect) {
+            double collectStart = MPI_Wtime();
+            collectLocalParts(&part, transposed, cols, rows);
+            collectTime = MPI_Wtime() - collectStart;
+        }
+
+        // every rank writes its part of T; without a sharded result rank 0
+        // writes all of it (column-major and tiled files always)
+        if (outputPath && !outOfCore) {
+            LocalPart whole = { 0, 0, 0, 0, rows, transposed };
+            if (!distOutput && rank == 0) {
+                whole.localRows = cols;
+                whole.localCols = rows;
+            }
+            double writeStart = MPI_Wtime();
+            if (wholeOutput) {
+                if (rank == 0 && matrixFileWrite(outputPath, transposed, cols, rows,
+                                                 outputOrder, fileTile) != 0) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+            } else {
+                writeLocalPart(outputPath, distOutput ? &part : &whole, cols, rows,
+                               outputOrder == ORDER_ROW_MAJOR ? fileTile : 0);
+            }
+            writeTime = MPI_Wtime() - writeStart;
+        }
     }
     else {
         // If it's already symmetric, skip transpose
@@ -136,25 +747,50 @@ int main(int argc, char *argv[])
 
     // 4) If transposition happened, compute checksum of transposed
     float transposedCheck = 0.0f;
-    if (doChecksum && rank == 0 && isSymBefore == 0) {
-        transposedCheck = partialChecksum(transposed, n);
+    if (doChecksum && rank == 0 && doTranspose) {
+        if (haveResult)      transposedCheck = partialChecksumRect(transposed, cols, rows);
+        else if (outputPath) {
+            // raw or row-major, see wholeOutput
+            MatrixFileHeader outHeader;
+            matrixFileInitHeader(&outHeader, cols, rows, ORDER_ROW_MAJOR, fileTile);
+            long outputOffset = (outputOrder == ORDER_ROW_MAJOR) ? (long)outHeader.dataOffset : 0;
+            transposedCheck = partialChecksumFile(outputPath, outputOffset, cols, rows,
+                                                  ORDER_ROW_MAJOR, 0);
+        }
     }
 
     // 5) rank 0 prints results
     if (rank == 0) {
         //printf("\n[Method: %s]\n", method);
 
+        if (strncmp(method, "mpi", 3) == 0) {
+            printf("   Ranks x threads: %d x %d\n", nprocs, omp_get_max_threads());
+        }
         printf("   Symmetry check: %.6f s\n", symTimeBefore);
 
-        if (isSymBefore == 0) {
+        if (doTranspose) {
             // Only relevant if we actually did the transpose
+            if (planReps > 0) {
+                printf("   Plan setup time: %.6f s (%d executions)\n", planTime, planReps);
+            }
             printf("   Transpose time: %.6f s\n", transposeTime);
+            if (distOutput && collect) {
+                printf("   Collect time: %.6f s\n", collectTime);
+            }
+            else if (distOutput && !outputPath) {
+                printf("   Distributed output: rank 0 holds T[%d:%d, %d:%d]\n",
+                       part.rowOffset, part.rowOffset + part.localRows,
+                       part.colOffset, part.colOffset + part.localCols);
+            }
+            if (outputPath && !outOfCore) {
+                printf("   Write time: %.6f s (%s)\n", writeTime, outputPath);
+            }
         }
 
         // Print checksums if requested
         if (doChecksum) {
             printf("   Partial checksum (original)   = %f\n", originalCheck);
-            if (isSymBefore == 0) {
+            if (doTranspose && (haveResult || outputPath)) {
                 printf("   Partial checksum (transposed) = %f\n", transposedCheck);
             }
         }
@@ -164,14 +800,24 @@ int main(int argc, char *argv[])
             //printf("Original matrix:\n");
             //printMatrix(matrix, n);
 
-            if (isSymBefore == 0) {
+            if (doTranspose && haveResult) {
                 // We only have a transposed matrix if we actually transposed
                 printf("Transposed matrix:\n");
-                printMatrix(transposed, n);
+                printMatrixRect(transposed, cols, rows);
             }
         }
-        free(matrix);
-        free(transposed);
+        if (!shm) {
+            matrixFree(matrix);
+            if (!inPlace) {
+                matrixFree(transposed);
+            }
+        }
+    }
+    freeLocalPart(&part);
+    shmMatricesFree(shm);
+    closeInputFile();
+    if (allocReportEnabled()) {
+        printAllocReport(rank);
     }
 
     MPI_Finalize();
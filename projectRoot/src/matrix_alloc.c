@@ -0,0 +1,309 @@
+#define _GNU_SOURCE  // MAP_ANONYMOUS, MAP_HUGETLB, MADV_HUGEPAGE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "matrix_alloc.h"
+
+#define MAX_LABELS    32
+#define DEFAULT_HUGE  ((size_t)2 << 20)   // x86-64 PMD huge page
+
+enum { MODE_OFF, MODE_THP, MODE_HUGETLB };
+enum { BACK_HEAP, BACK_4K, BACK_THP, BACK_HUGETLB, BACK_COUNT };
+
+static const char *modeNames[]    = { "off", "thp", "hugetlb" };
+static const char *backingNames[] = { "heap", "4k", "thp", "hugetlb" };
+
+typedef struct {
+    void   *ptr;
+    size_t  bytes;      // requested
+    size_t  mapped;     // length of the mapping, 0 for the heap
+    int     backing;
+    int     label;
+    int     sampled;    // huge pages already counted
+} LiveBuffer;
+
+typedef struct {
+    const char *label;
+    long        count;
+    size_t      bytes;
+    size_t      hugeBytes;
+    int         backings;   // bit per BACK_*
+} LabelStats;
+
+static int hugePages = MODE_THP;
+static int allocReport = 0;
+static int hugetlbFallbacks = 0;
+
+static LiveBuffer *live = NULL;
+static int liveCount = 0, liveCapacity = 0;
+static LabelStats labels[MAX_LABELS];
+static int labelCount = 0;
+
+int setHugePages(const char *mode)
+{
+    for (int m = MODE_OFF; m <= MODE_HUGETLB; m++) {
+        if (strcmp(mode, modeNames[m]) == 0) {
+            hugePages = m;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const char *hugePagesName(void)
+{
+    return modeNames[hugePages];
+}
+
+void setAllocReport(int enabled)
+{
+    allocReport = enabled;
+}
+
+int allocReportEnabled(void)
+{
+    return allocReport;
+}
+
+// Transparent huge page size, also the threshold for a mapping of its own.
+static size_t thpSize(void)
+{
+    static size_t size = 0;
+    if (size == 0) {
+        size = DEFAULT_HUGE;
+        FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+        unsigned long value;
+        if (f) {
+            if (fscanf(f, "%lu", &value) == 1 && value > 0) size = value;
+            fclose(f);
+        }
+    }
+    return size;
+}
+
+// Default hugetlbfs page size (Hugepagesize in /proc/meminfo).
+static size_t hugetlbSize(void)
+{
+    static size_t size = 0;
+    if (size == 0) {
+        size = DEFAULT_HUGE;
+        FILE *f = fopen("/proc/meminfo", "r");
+        char line[128];
+        unsigned long kb;
+        while (f && fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1 && kb > 0) {
+                size = (size_t)kb << 10;
+                break;
+            }
+        }
+        if (f) fclose(f);
+    }
+    return size;
+}
+
+static size_t roundUp(size_t bytes, size_t unit)
+{
+    return (bytes + unit - 1) / unit * unit;
+}
+
+/*
+ Anonymous mapping of 'bytes' (a multiple of the page size) starting on an
+ 'align' boundary: map 'align' more and unmap the ragged head and tail. An
+ aligned start lets the kernel use a huge page from the first byte on.
+ */
+static void *mapAligned(size_t bytes, size_t align)
+{
+    size_t length = bytes + align;
+    char *raw = (char *)mmap(NULL, length, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+
+    char *base = (char *)(((uintptr_t)raw + align - 1) & ~(uintptr_t)(align - 1));
+    if (base > raw) munmap(raw, (size_t)(base - raw));
+    size_t tail = (size_t)((raw + length) - (base + bytes));
+    if (tail > 0) munmap(base + bytes, tail);
+    return base;
+}
+
+/*
+ Bytes of [ptr, ptr + length) on transparent huge pages, from AnonHugePages
+ in /proc/self/smaps. Adjacent mappings with the same flags are merged into
+ one area, so each area contributes in proportion to its overlap.
+ */
+static size_t smapsHugeBytes(const void *ptr, size_t length)
+{
+    FILE *f = fopen("/proc/self/smaps", "r");
+    if (!f) return 0;
+
+    uintptr_t lo = (uintptr_t)ptr, hi = lo + length;
+    uintptr_t start = 0, end = 0;
+    double huge = 0.0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long a, b, kb;
+        if (sscanf(line, "%lx-%lx ", &a, &b) == 2) {
+            start = a;
+            end = b;
+        } else if (sscanf(line, "AnonHugePages: %lu kB", &kb) == 1 && end > lo && start < hi) {
+            uintptr_t from = (start > lo) ? start : lo;
+            uintptr_t to   = (end < hi) ? end : hi;
+            huge += (double)kb * 1024.0 * (double)(to - from) / (double)(end - start);
+        }
+    }
+    fclose(f);
+    return (size_t)huge;
+}
+
+// Adds what is on huge pages now to the buffer's label, once per buffer.
+static void sampleHugePages(LiveBuffer *buf)
+{
+    if (buf->sampled) return;
+    buf->sampled = 1;
+
+    size_t huge = 0;
+    if (buf->backing == BACK_HUGETLB)  huge = buf->bytes;
+    else if (buf->backing == BACK_THP) huge = smapsHugeBytes(buf->ptr, buf->mapped);
+    labels[buf->label].hugeBytes += (huge < buf->bytes) ? huge : buf->bytes;
+}
+
+// Statistics slot of 'label'; once all are taken the last one is shared.
+static int labelIndex(const char *label)
+{
+    if (!label) label = "unlabelled";
+    for (int l = 0; l < labelCount; l++) {
+        if (strcmp(labels[l].label, label) == 0) return l;
+    }
+    if (labelCount == MAX_LABELS) return MAX_LABELS - 1;
+    labels[labelCount].label = label;
+    return labelCount++;
+}
+
+static void release(void *ptr, size_t mapped)
+{
+    if (mapped > 0) munmap(ptr, mapped);
+    else            free(ptr);
+}
+
+void *matrixAlloc(size_t bytes, const char *label)
+{
+    void *ptr = NULL;
+    size_t mapped = 0;
+    int backing = BACK_HEAP;
+
+    if (bytes >= thpSize()) {
+        // ---- 1) reserved huge pages (MAP_HUGETLB memory starts page aligned)
+        if (hugePages == MODE_HUGETLB) {
+            mapped = roundUp(bytes, hugetlbSize());
+            void *p = mmap(NULL, mapped, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) {
+                ptr = p;
+                backing = BACK_HUGETLB;
+            } else {
+                hugetlbFallbacks++;
+            }
+        }
+
+        // ---- 2) transparent huge pages, or 4 KiB pages for the baseline
+        if (!ptr) {
+            mapped = roundUp(bytes, thpSize());
+            ptr = mapAligned(mapped, thpSize());
+            if (ptr && hugePages == MODE_OFF) {
+                madvise(ptr, mapped, MADV_NOHUGEPAGE);
+                backing = BACK_4K;
+            } else if (ptr) {
+                backing = (madvise(ptr, mapped, MADV_HUGEPAGE) == 0) ? BACK_THP : BACK_4K;
+            }
+        }
+    }
+
+    // ---- 3) small buffers, and mappings that failed
+    if (!ptr) {
+        mapped = 0;
+        backing = BACK_HEAP;
+        if (posix_memalign(&ptr, MATRIX_ALIGN, bytes > 0 ? bytes : MATRIX_ALIGN) != 0) {
+            return NULL;
+        }
+    }
+
+    // ---- 4) registry: matrixFree needs the mapping, the report the label
+    if (liveCount == liveCapacity) {
+        int capacity = liveCapacity ? 2 * liveCapacity : 64;
+        LiveBuffer *grown = (LiveBuffer *)realloc(live, capacity * sizeof(LiveBuffer));
+        if (!grown) {
+            release(ptr, mapped);
+            return NULL;
+        }
+        live = grown;
+        liveCapacity = capacity;
+    }
+    int l = labelIndex(label);
+    live[liveCount++] = (LiveBuffer){ ptr, bytes, mapped, backing, l, 0 };
+    labels[l].count++;
+    labels[l].bytes += bytes;
+    labels[l].backings |= 1 << backing;
+    return ptr;
+}
+
+void *matrixCalloc(size_t count, size_t size, const char *label)
+{
+    void *ptr = matrixAlloc(count * size, label);
+    // fresh anonymous mappings are already zero
+    if (ptr && live[liveCount - 1].mapped == 0) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void matrixFree(void *ptr)
+{
+    if (!ptr) return;
+
+    for (int k = liveCount - 1; k >= 0; k--) {
+        if (live[k].ptr != ptr) continue;
+        if (allocReport) sampleHugePages(&live[k]);
+        release(live[k].ptr, live[k].mapped);
+        live[k] = live[--liveCount];
+        return;
+    }
+    free(ptr);
+}
+
+void matrixAllocTotals(size_t *bytes, size_t *hugeBytes)
+{
+    for (int k = 0; k < liveCount; k++) {
+        sampleHugePages(&live[k]);
+    }
+    *bytes = 0;
+    *hugeBytes = 0;
+    for (int l = 0; l < labelCount; l++) {
+        *bytes += labels[l].bytes;
+        *hugeBytes += labels[l].hugeBytes;
+    }
+}
+
+void matrixAllocReport(void)
+{
+    size_t bytes, hugeBytes;
+    matrixAllocTotals(&bytes, &hugeBytes);
+
+    printf("   Allocations (--hugepages %s, %zu KiB huge pages):\n", hugePagesName(),
+           (hugePages == MODE_HUGETLB ? hugetlbSize() : thpSize()) >> 10);
+    for (int l = 0; l < labelCount; l++) {
+        const LabelStats *s = &labels[l];
+        char backing[32] = "";
+        for (int b = 0; b < BACK_COUNT; b++) {
+            if (!(s->backings & (1 << b))) continue;
+            if (backing[0]) strcat(backing, "+");
+            strcat(backing, backingNames[b]);
+        }
+        printf("      %-14s %6ld x %10.2f MiB  %-12s %5.1f%% on huge pages\n", s->label, s->count,
+               s->bytes / 1048576.0, backing, s->bytes ? 100.0 * s->hugeBytes / s->bytes : 0.0);
+    }
+    if (hugetlbFallbacks > 0) {
+        printf("      %d buffers fell back to thp: no free hugetlb pages (vm.nr_hugepages)\n",
+               hugetlbFallbacks);
+    }
+}
@@ -0,0 +1,260 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "matrix_io.h"
+#include "mpi_common.h"  // transposeBlockedThreads
+#include "simd_kernels.h"
+#include "matrix_alloc.h"
+
+/*
+ Hash of one element for the tile checksums: its bits and its position
+ inside the tile, so swapped or moved values change the sum too. Elements
+ of up to 4 bytes are zero-extended (float files hash as they always
+ have); 8-byte elements are mixed with the position instead.
+ */
+static inline uint64_t elementHash(const void *value, size_t es, uint32_t pos)
+{
+    uint64_t x;
+    if (es == 8) {
+        memcpy(&x, value, sizeof x);
+        x ^= (uint64_t)pos * 0x9E3779B97F4A7C15ULL;
+    } else {
+        uint32_t bits = 0;
+        memcpy(&bits, value, es);
+        x = ((uint64_t)pos << 32) | bits;
+    }
+    x ^= x >> 31;
+    x *= 0x9E3779B97F4A7C15ULL;
+    x ^= x >> 29;
+    return x;
+}
+
+static uint64_t tilesAlong(uint64_t n, uint32_t tileSize)
+{
+    return (n + tileSize - 1) / tileSize;
+}
+
+static size_t payloadElements(const MatrixFileHeader *header)
+{
+    if (header->order == ORDER_TILED) {
+        size_t ts = header->tileSize;
+        return (size_t)header->numTiles * ts * ts;
+    }
+    return (size_t)header->rows * header->cols;
+}
+
+void matrixFileInitHeader(MatrixFileHeader *header, int rows, int cols,
+                          int order, int tileSize)
+{
+    memset(header, 0, sizeof *header);
+    memcpy(header->magic, MATRIX_FILE_MAGIC, sizeof MATRIX_FILE_MAGIC);
+    header->version  = MATRIX_FILE_VERSION;
+    header->elemType = (uint32_t)elementType();
+    header->order    = (uint32_t)order;
+    header->tileSize = (uint32_t)tileSize;
+    header->rows     = (uint64_t)rows;
+    header->cols     = (uint64_t)cols;
+    header->numTiles = tilesAlong(header->rows, header->tileSize)
+                     * tilesAlong(header->cols, header->tileSize);
+
+    uint64_t tableEnd  = sizeof *header + header->numTiles * sizeof(uint64_t);
+    header->dataOffset = (tableEnd + MATRIX_FILE_ALIGN - 1) / MATRIX_FILE_ALIGN * MATRIX_FILE_ALIGN;
+}
+
+int matrixFileProbe(const char *path, MatrixFileHeader *header)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) return 0;
+
+    int magic = fread(header, sizeof *header, 1, file) == 1
+             && memcmp(header->magic, MATRIX_FILE_MAGIC, sizeof MATRIX_FILE_MAGIC) == 0;
+    fclose(file);
+    if (!magic) return 0;
+
+    // Everything else is sized from the header: it has to agree with itself
+    // before anything is allocated or indexed from it
+    int valid = header->version == MATRIX_FILE_VERSION
+             && header->order <= ORDER_TILED && header->elemType < ELEM_TYPE_COUNT
+             && header->tileSize > 0 && header->tileSize <= MATRIX_FILE_MAX_TILE
+             && header->rows > 0 && header->rows <= INT_MAX
+             && header->cols > 0 && header->cols <= INT_MAX;
+    if (valid) {
+        uint64_t numTiles = tilesAlong(header->rows, header->tileSize)
+                          * tilesAlong(header->cols, header->tileSize);
+        uint64_t tableEnd = sizeof *header + numTiles * sizeof(uint64_t);
+        valid = header->numTiles == numTiles
+             && header->dataOffset >= tableEnd && header->dataOffset % MATRIX_FILE_ALIGN == 0;
+    }
+    if (!valid) {
+        fprintf(stderr, "'%s' has an inconsistent matrix file header\n", path);
+        return -1;
+    }
+    return 1;
+}
+
+void matrixTileSums(const MatrixFileHeader *header, const void *block, int ld,
+                    int rowOffset, int colOffset, int rows, int cols, uint64_t *sums)
+{
+    if (rows <= 0 || cols <= 0) return;
+
+    size_t es = elementBytes();
+    int ts = (int)header->tileSize;
+    long tilesJ = (long)tilesAlong(header->cols, header->tileSize);
+    int I0 = rowOffset / ts, I1 = (rowOffset + rows - 1) / ts;
+    int J0 = colOffset / ts, J1 = (colOffset + cols - 1) / ts;
+    int spanJ = J1 - J0 + 1;
+    long tiles = (long)(I1 - I0 + 1) * spanJ;
+
+    // one thread per tile, so no two threads add to the same entry
+#pragma omp parallel for default(none) \
+        shared(block, ld, rowOffset, colOffset, rows, cols, sums, es, ts, tilesJ, I0, J0, spanJ, tiles) \
+        schedule(dynamic)
+    for (long t = 0; t < tiles; t++) {
+        int I = I0 + (int)(t / spanJ), J = J0 + (int)(t % spanJ);
+        int rStart = (I * ts > rowOffset) ? I * ts : rowOffset;
+        int cStart = (J * ts > colOffset) ? J * ts : colOffset;
+        int rEnd = ((I + 1) * ts < rowOffset + rows) ? (I + 1) * ts : rowOffset + rows;
+        int cEnd = ((J + 1) * ts < colOffset + cols) ? (J + 1) * ts : colOffset + cols;
+
+        uint64_t sum = 0;
+        for (int r = rStart; r < rEnd; r++) {
+            const char *row = (const char *)block + (size_t)(r - rowOffset) * ld * es;
+            uint32_t base = (uint32_t)(r - I * ts) * ts;
+            for (int c = cStart; c < cEnd; c++) {
+                sum += elementHash(&row[(size_t)(c - colOffset) * es], es,
+                                   base + (uint32_t)(c - J * ts));
+            }
+        }
+        sums[(size_t)I * tilesJ + J] += sum;
+    }
+}
+
+// Tiled payload <-> row-major matrix, one tile per iteration.
+static void convertTiled(const MatrixFileHeader *header, void *tiles, void *matrix, int toMatrix)
+{
+    size_t es = elementBytes();
+    int rows = (int)header->rows, cols = (int)header->cols;
+    int ts = (int)header->tileSize;
+    long tilesJ = (long)tilesAlong(header->cols, header->tileSize);
+    long nTiles = (long)header->numTiles;
+
+#pragma omp parallel for default(none) shared(tiles, matrix, toMatrix, es, rows, cols, ts, tilesJ, nTiles) \
+        schedule(static)
+    for (long t = 0; t < nTiles; t++) {
+        int i0 = (int)(t / tilesJ) * ts, j0 = (int)(t % tilesJ) * ts;
+        int h = (rows - i0 < ts) ? rows - i0 : ts;
+        int w = (cols - j0 < ts) ? cols - j0 : ts;
+        char *tile = (char *)tiles + (size_t)t * ts * ts * es;
+        for (int r = 0; r < h; r++) {
+            char *m = (char *)matrix + ((size_t)(i0 + r) * cols + j0) * es;
+            if (toMatrix) memcpy(m, &tile[(size_t)r * ts * es], w * es);
+            else          memcpy(&tile[(size_t)r * ts * es], m, w * es);
+        }
+    }
+}
+
+int matrixFileRead(const char *path, void *matrix, int rows, int cols)
+{
+    MatrixFileHeader header;
+    if (matrixFileProbe(path, &header) != 1) {
+        fprintf(stderr, "'%s' is not a binary matrix file\n", path);
+        return 1;
+    }
+    if (header.elemType != (uint32_t)elementType() || header.rows != (uint64_t)rows
+        || header.cols != (uint64_t)cols) {
+        fprintf(stderr, "'%s' does not hold a %d x %d %s matrix\n", path, rows, cols,
+                elementTypeName(elementType()));
+        return 1;
+    }
+
+    FILE *file = fopen(path, "rb");
+    uint64_t *stored   = (uint64_t *)malloc(header.numTiles * sizeof(uint64_t));
+    uint64_t *computed = (uint64_t *)calloc(header.numTiles, sizeof(uint64_t));
+    size_t count = payloadElements(&header);
+    void *payload = (header.order == ORDER_ROW_MAJOR)
+                  ? matrix : matrixAlloc(count * elementBytes(), "file payload");
+    int status = 1;
+
+    // ---- 1) checksum table and payload, one read each
+    if (file && stored && computed && payload
+        && fseek(file, sizeof header, SEEK_SET) == 0
+        && fread(stored, sizeof(uint64_t), header.numTiles, file) == header.numTiles
+        && fseek(file, (long)header.dataOffset, SEEK_SET) == 0
+        && fread(payload, elementBytes(), count, file) == count) {
+
+        // ---- 2) to row-major
+        if (header.order == ORDER_COL_MAJOR) {
+            transposeBlockedThreads(payload, rows, matrix, cols, cols, rows, 64);
+        } else if (header.order == ORDER_TILED) {
+            convertTiled(&header, payload, matrix, 1);
+        }
+
+        // ---- 3) verify
+        matrixTileSums(&header, matrix, cols, 0, 0, rows, cols, computed);
+        uint64_t bad = 0, first = 0;
+        for (uint64_t t = 0; t < header.numTiles; t++) {
+            if (stored[t] != computed[t] && bad++ == 0) first = t;
+        }
+        if (bad) {
+            uint64_t tilesJ = tilesAlong(header.cols, header.tileSize);
+            fprintf(stderr, "'%s': %llu of %llu tile checksums do not match (first: tile %llu, %llu)\n",
+                    path, (unsigned long long)bad, (unsigned long long)header.numTiles,
+                    (unsigned long long)(first / tilesJ), (unsigned long long)(first % tilesJ));
+        } else {
+            status = 0;
+        }
+    } else {
+        fprintf(stderr, "Cannot read '%s'\n", path);
+    }
+
+    if (payload != matrix) matrixFree(payload);
+    free(stored);
+    free(computed);
+    if (file) fclose(file);
+    return status;
+}
+
+int matrixFileWrite(const char *path, const void *matrix, int rows, int cols,
+                    int order, int tileSize)
+{
+    MatrixFileHeader header;
+    matrixFileInitHeader(&header, rows, cols, order, tileSize);
+
+    uint64_t *sums = (uint64_t *)calloc(header.numTiles, sizeof(uint64_t));
+    size_t count = payloadElements(&header);
+    void *payload = (order == ORDER_ROW_MAJOR)
+                  ? (void *)matrix : matrixCalloc(count, elementBytes(), "file payload");
+    FILE *file = fopen(path, "wb");
+    if (!file || !sums || !payload) {
+        fprintf(stderr, "Cannot write '%s'\n", path);
+        if (file) fclose(file);
+        if (payload != matrix) matrixFree(payload);
+        free(sums);
+        return 1;
+    }
+
+    // ---- 1) checksums and payload layout
+    matrixTileSums(&header, matrix, cols, 0, 0, rows, cols, sums);
+    if (order == ORDER_COL_MAJOR) {
+        transposeBlockedThreads(matrix, cols, payload, rows, rows, cols, 64);
+    } else if (order == ORDER_TILED) {
+        convertTiled(&header, payload, (void *)matrix, 0);
+    }
+
+    // ---- 2) header, table, zero padding up to the aligned payload
+    size_t tableEnd = sizeof header + header.numTiles * sizeof(uint64_t);
+    char pad[MATRIX_FILE_ALIGN] = { 0 };
+    int ok = fwrite(&header, sizeof header, 1, file) == 1
+          && fwrite(sums, sizeof(uint64_t), header.numTiles, file) == header.numTiles
+          && fwrite(pad, 1, header.dataOffset - tableEnd, file) == header.dataOffset - tableEnd
+          && fwrite(payload, elementBytes(), count, file) == count;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        fprintf(stderr, "Short write to '%s'\n", path);
+    }
+
+    if (payload != matrix) matrixFree(payload);
+    free(sums);
+    return ok ? 0 : 1;
+}
@@ -3,134 +3,101 @@
 #include <stdlib.h>
 #include <string.h>
 #include "matrix_operations.h"
+#include "mpi_common.h"
+#include "matrix_alloc.h"
 
 
-int checkSymMPI(float *matrix, int n)
+int checkSymMPI(void *matrix, int n)
 {
-    int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
-
-    // --- 1) Broadcast the entire matrix ---
-    // Rank 0 already allocated and filled 'matrix'.
-    // Other ranks need to allocate memory for the full matrix.
-    if (rank != 0) {
-        matrix = (float *)malloc(n * n * sizeof(float));
-    }
-
-    double t0 = MPI_Wtime();
-    MPI_Bcast(matrix, n*n, MPI_FLOAT, 0, MPI_COMM_WORLD);
-
-    // --- 2) Local check for symmetry ---
-    // We'll divide rows among processes in a simple contiguous chunk manner:
-    int rowsPerProc = n / size;            
-    int remainder   = n % size;            // leftover rows if not divisible
-    int localStart, localEnd;
+    return checkSymRowsMPI(matrix, n);
+}
 
-    if (rank < remainder) {
-        // ranks [0..remainder-1] handle (rowsPerProc + 1) rows each
-        localStart = rank * (rowsPerProc + 1);
-        localEnd   = localStart + (rowsPerProc + 1);
-    } else {
-        // ranks [remainder..size-1] handle rowsPerProc each
-        localStart = remainder * (rowsPerProc + 1) 
-                     + (rank - remainder) * rowsPerProc;
-        localEnd   = localStart + rowsPerProc;
-    }
 
-    int localSym = 1;
-    // For each row i in [localStart, localEnd), check columns j > i
-    for (int i = localStart; i < localEnd && localSym; i++) {
-        for (int j = i + 1; j < n; j++) {
-            if (matrix[i * n + j] != matrix[j * n + i]) {
-                localSym = 0;
-                break;
-            }
-        }
-    }
 
-    // --- 3) Combine results ---
-    int globalSym = 1;
-    MPI_Allreduce(&localSym, &globalSym, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+void matTransposeMPI(void *matrix, void *transposed, int n)
+{
+    matTransposeMPIRect(matrix, transposed, n, n);
+}
 
-    double t1 = MPI_Wtime();
+/*
+ matrix     [IN]  On rank 0, the full rows x cols input. NULL on other ranks.
+ transposed [OUT] On rank 0, the full cols x rows transpose.
+ Any rows, cols and size: rank r builds its row slab of T (see slabStart).
+ */
+void matTransposeMPIRect(void *matrix, void *transposed, int rows, int cols)
+{
+    LocalPart part;
+    matTransposeMPIDist(matrix, rows, cols, &part);
 
-    // Print stats from rank 0
-    if (rank == 0) {
-        if (globalSym)
-            printf("Broadcast MPI: The matrix is symmetric.\n");
-        else
-            printf("Broadcast MPI: The matrix is NOT symmetric.\n");
-        printf("Time taken: %f s\n", (t1 - t0));
-    }
+    // -------------------------------------------------
+    // 5) Gather all partial transposed blocks on rank 0
+    //    Each rank has localRows*rows elements
+    // -------------------------------------------------
+    gatherRows(part.data, transposed, cols, rows);
 
-    // If rank != 0, we allocated matrix for the broadcast
-    if (rank != 0) {
-        free(matrix);
-    }
-    return globalSym;
+    freeLocalPart(&part);
 }
 
-
-
-void matTransposeMPI(float *matrix, float *transposed, int n)
+/*
+ Steps 1-4 of matTransposeMPIRect: rank r keeps its row slab of T in
+ 'part' instead of gathering it.
+ */
+void matTransposeMPIDist(void *matrix, int rows, int cols, LocalPart *part)
 {
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
     // -------------------------------------------------
-    // 1) Broadcast the entire matrix M to all ranks.
-    //    We assume memory can handle it on each rank.
+    // 1) Each rank builds its slab of localRows rows of T, i.e. it needs
+    //    the rows x localRows column strip of M at localStart
     // -------------------------------------------------
-    if (rank != 0) {
-        // Non-root ranks allocate space for the entire matrix
-        matrix = (float *)malloc(n * n * sizeof(float));
-    }
-    MPI_Bcast(matrix, n*n, MPI_FLOAT, 0, MPI_COMM_WORLD);
+    int localStart = slabStart(cols, rank);
+    int localRows = slabStart(cols, rank + 1) - localStart;
 
     // -------------------------------------------------
-    // 2) Since n % size == 0, each rank gets exactly n/size rows
+    // 2) Broadcast the entire matrix M to all ranks.
+    //    We assume memory can handle it on each rank.
+    //    With --local-init or --input each rank loads just its strip instead.
     // -------------------------------------------------
-    int localRows = n / size;
-    int localStart = rank * localRows;
-    int localEnd   = localStart + localRows;
+    const void *strip;
+    int stripLd;
+    void *ownBuffer = NULL;
+    if (localSourceEnabled()) {
+        ownBuffer = matrixAlloc((size_t)rows * localRows * elementBytes(), "M strip");
+        loadLocalBlock(ownBuffer, localRows, 0, localStart, rows, localRows);
+        strip   = ownBuffer;
+        stripLd = localRows;
+    } else {
+        if (rank != 0) {
+            // Non-root ranks allocate space for the entire matrix
+            ownBuffer = matrixAlloc((size_t)rows * cols * elementBytes(), "M copy");
+            matrix = ownBuffer;
+        }
+        MPI_Bcast(matrix, rows*cols, elementMPIType(), 0, MPI_COMM_WORLD);
+        strip   = ELEM(matrix, localStart);
+        stripLd = cols;
+    }
 
     // -------------------------------------------------
     // 3) Allocate a local buffer for our portion of transposed
-    //    Each rank computes localRows of T, each row has n columns
+    //    Each rank computes localRows of T, each row has 'rows' columns
     // -------------------------------------------------
-    float *localTransposed = (float *)malloc(localRows * n * sizeof(float));
+    void *localTransposed = matrixAlloc((size_t)localRows * rows * elementBytes(), "local T");
 
     // -------------------------------------------------
     // 4) Compute the local portion of the transpose
-    //    T[i,j] = M[j,i], for i in [localStart, localEnd)
+    //    T[i,j] = M[j,i], for i in [localStart, localStart + localRows)
+    //    i.e. transpose the rows x localRows column strip starting at column localStart
     // -------------------------------------------------
-    for (int i = localStart; i < localEnd; i++) {
-        for (int j = 0; j < n; j++) {
-            localTransposed[(i - localStart) * n + j] = matrix[j * n + i];
-        }
-    }
+    transposeBlockedThreads(strip, stripLd, localTransposed, rows, rows, localRows, 64);
 
-    // -------------------------------------------------
-    // 5) Gather all partial transposed blocks on rank 0
-    //    Each rank has localRows*n elements
-    // -------------------------------------------------
-    int localCount = localRows * n;
-
-    MPI_Gather(
-        localTransposed,
-        localCount,
-        MPI_FLOAT,
-        transposed,   
-        localCount,
-        MPI_FLOAT,
-        0,
-        MPI_COMM_WORLD
-    );
+    part->rowOffset = localStart;
+    part->colOffset = 0;
+    part->localRows = localRows;
+    part->localCols = rows;
+    part->ld        = rows;
+    part->data      = localTransposed;
 
-    free(localTransposed);
-    if (rank != 0) {
-        free(matrix);
-    }
-}
\ No newline at end of file
+    matrixFree(ownBuffer);
+}
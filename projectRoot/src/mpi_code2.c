@@ -3,72 +3,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include "matrix_operations.h"
+#include "matrix_alloc.h"
 
 
-int checkSymMPI2(float *matrix, int n)
+int checkSymMPI2(void *matrix, int n)
 {
-    int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
-
-    // --- 1) Broadcast the entire matrix ---
-    // Rank 0 already allocated and filled 'matrix'.
-    // Other ranks need to allocate memory for the full matrix.
-    if (rank != 0) {
-        matrix = (float *)malloc(n * n * sizeof(float));
-    }
-
-    double t0 = MPI_Wtime();
-    MPI_Bcast(matrix, n*n, MPI_FLOAT, 0, MPI_COMM_WORLD);
-
-    // --- 2) Local check for symmetry ---
-    // We'll divide rows among processes in a simple contiguous chunk manner:
-    int rowsPerProc = n / size;            
-    int remainder   = n % size;            // leftover rows if not divisible
-    int localStart, localEnd;
-
-    if (rank < remainder) {
-        // ranks [0..remainder-1] handle (rowsPerProc + 1) rows each
-        localStart = rank * (rowsPerProc + 1);
-        localEnd   = localStart + (rowsPerProc + 1);
-    } else {
-        // ranks [remainder..size-1] handle rowsPerProc each
-        localStart = remainder * (rowsPerProc + 1) 
-                     + (rank - remainder) * rowsPerProc;
-        localEnd   = localStart + rowsPerProc;
-    }
-
-    int localSym = 1;
-    // For each row i in [localStart, localEnd), check columns j > i
-    for (int i = localStart; i < localEnd && localSym; i++) {
-        for (int j = i + 1; j < n; j++) {
-            if (matrix[i * n + j] != matrix[j * n + i]) {
-                localSym = 0;
-                break;
-            }
-        }
-    }
-
-    // --- 3) Combine results ---
-    int globalSym = 1;
-    MPI_Allreduce(&localSym, &globalSym, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
-
-    double t1 = MPI_Wtime();
-
-    // Print stats from rank 0
-    if (rank == 0) {
-        if (globalSym)
-            printf("Broadcast MPI: The matrix is symmetric.\n");
-        else
-            printf("Broadcast MPI: The matrix is NOT symmetric.\n");
-        printf("Time taken: %f s\n", (t1 - t0));
-    }
-
-    // If rank != 0, we allocated matrix for the broadcast
-    if (rank != 0) {
-        free(matrix);
-    }
-    return globalSym;
+    return checkSymRowsMPI(matrix, n);
 }
 
 
@@ -76,109 +16,170 @@ int checkSymMPI2(float *matrix, int n)
 /*
   Row-scatter + Column-gather MPI transpose.
  
-         1) Scatter rows from rank 0 to each rank, so rank r gets (n/size) rows.
+         1) Scatter rows from rank 0 to each rank, so rank r gets its row slab.
          2) For each column c, gather partial columns from all ranks
             and assemble them into row c of the transposed matrix on rank 0.
  
          This avoids broadcasting the entire matrix. Each non-zero rank
-         only holds (n/size)*n floats from M at a time.
+         only holds (rows/size)*cols elements from M at a time.
  
- matrix     [IN]  On rank 0, the full n*n input. NULL on other ranks.
- transposed [OUT] On rank 0, the full n*n transposed. NULL on others.
- n          The dimension of the matrix (n x n).
+ matrix     [IN]  On rank 0, the full rows x cols input. NULL on other ranks.
+ transposed [OUT] On rank 0, the full cols x rows transposed. NULL on others.
+ rows, cols The dimensions of the matrix (rows x cols).
  */
-void matTransposeMPI2(float *matrix, float *transposed, int n)
+void matTransposeMPI2(void *matrix, void *transposed, int n)
+{
+    matTransposeMPI2Rect(matrix, transposed, n, n);
+}
+
+void matTransposeMPI2Rect(void *matrix, void *transposed, int rows, int cols)
 {
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    // We assume n % size == 0 so that each rank gets exactly n/size rows
-    int localRows = n / size;
+    // Rank r holds the row slab [slabStart(rows, r), slabStart(rows, r+1)) of M
+    int localRows = slabStart(rows, rank + 1) - slabStart(rows, rank);
+    int *counts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    for (int r = 0; r < size; r++) {
+        displs[r] = slabStart(rows, r);
+        counts[r] = slabStart(rows, r + 1) - displs[r];
+    }
 
     // ----------------------------------------------------------------
-    // 1) Scatter rows of M from rank 0 to each process
-    //    => localM has (localRows x n) floats (row-major)
+    // 1) Scatter rows of M from rank 0 to each process (or generate them)
+    //    => localM has (localRows x cols) elements (row-major)
     // ----------------------------------------------------------------
-    float *localM = (float *)malloc(localRows * n * sizeof(float));
-    if (!localM) {
+    void *localM = matrixAlloc((size_t)localRows * cols * elementBytes(), "local M");
+    if (!localM && localRows > 0) {
         fprintf(stderr, "Rank %d: Could not allocate localM\n", rank);
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
 
-    MPI_Scatter(
-         matrix,         
-         localRows * n,  
-         MPI_FLOAT,
-         localM,
-         localRows * n,
-         MPI_FLOAT,
-         0,
-         MPI_COMM_WORLD
-    );
+    scatterRows(matrix, localM, rows, cols);
 
     // ----------------------------------------------------------------
     // 2) Column-by-column gather approach:
-    //    For each column c in [0..n-1]:
+    //    For each column c in [0..cols-1]:
     //      - Each rank extracts the relevant entries from localM[]
     //      - MPI_Gather them back to rank 0
     //      - On rank 0, place them into row c of 'transposed'
     // ----------------------------------------------------------------
 
     // A small buffer on each rank to hold the column portion of size localRows
-    float *sendCol = (float *)malloc(localRows * sizeof(float));
-    // On rank 0, we need to gather from all ranks => a buffer of size n
-    float *recvCol = NULL;
+    void *sendCol = matrixAlloc(localRows * elementBytes(), "column buffer");
+    // On rank 0, we need to gather from all ranks => a buffer of size rows
+    void *recvCol = NULL;
     if (rank == 0) {
-        recvCol = (float *)malloc(n * sizeof(float));
+        recvCol = matrixAlloc(rows * elementBytes(), "column buffer");
         if (!transposed) {
             fprintf(stderr, "Rank 0: 'transposed' is NULL\n");
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
     }
 
-    for (int c = 0; c < n; c++)
+    for (int c = 0; c < cols; c++)
     {
         // (a) On each rank, copy column c from localM into 'sendCol'
-        //     localM has localRows rows x n cols
-        //     localM[r*n + c] is element (r,c) of this local chunk
-        for (int r = 0; r < localRows; r++) {
-            sendCol[r] = localM[r*n + c];
-        }
+        //     localM has localRows rows x cols cols
+        //     localM[r*cols + c] is element (r,c) of this local chunk
+        //     (a localRows x 1 transpose)
+        transposeTile(ELEM(localM, c), cols, sendCol, 1, localRows, 1);
 
         // (b) Gather these partial columns on rank 0
-        //     => each rank sends 'sendCol' (localRows floats)
-        //        rank 0 receives them into 'recvCol' (n floats)
-        MPI_Gather(
+        //     => each rank sends 'sendCol' (localRows elements)
+        //        rank 0 receives them into 'recvCol' (rows elements)
+        MPI_Gatherv(
              sendCol,
              localRows,
-             MPI_FLOAT,
+             elementMPIType(),
              recvCol,   
-             localRows,
-             MPI_FLOAT,
+             counts,
+             displs,
+             elementMPIType(),
              0,
              MPI_COMM_WORLD
         );
 
         // (c) On rank 0, place the gathered column into row c of 'transposed'
         if (rank == 0) {
-            // 'recvCol' has n floats => each float is localRows portion from a rank
+            // 'recvCol' has 'rows' elements => localRows of them from each rank
             // The final transposed row index = c, so transposed[c, row] in row-major:
-            //   transposed[c*n + row]
-            // But we just fill row from [0..n-1]
-            for (int rowGlobal = 0; rowGlobal < n; rowGlobal++) {
-                // T[c, rowGlobal] = M[rowGlobal, c]
-                // stored as transposed[c*n + rowGlobal]
-                transposed[c*n + rowGlobal] = recvCol[rowGlobal];
-            }
+            //   transposed[c*rows + row] = M[row, c] = recvCol[row]
+            memcpy(ELEM(transposed, (size_t)c*rows), recvCol, rows * elementBytes());
         }
     }
 
 
-    free(sendCol);
-    free(localM);
+    matrixFree(sendCol);
+    matrixFree(localM);
+    free(displs);
+    free(counts);
 
     if (rank == 0) {
-        free(recvCol);
+        matrixFree(recvCol);
     }
 }
+
+/*
+ Distributed-output variant: the same column-by-column gathers, but column
+ c of M (row c of T) is gathered to the rank that owns row c of T instead
+ of rank 0. Rank r ends up with its row slab of T.
+ */
+void matTransposeMPI2Dist(void *matrix, int rows, int cols, LocalPart *part)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int localRows = slabStart(rows, rank + 1) - slabStart(rows, rank);   // rows of M here
+    int ownedStart = slabStart(cols, rank);
+    int ownedCols = slabStart(cols, rank + 1) - ownedStart;              // rows of T here
+
+    int *counts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    for (int r = 0; r < size; r++) {
+        displs[r] = slabStart(rows, r);
+        counts[r] = slabStart(rows, r + 1) - displs[r];
+    }
+
+    // 1) Scatter rows of M from rank 0 to each process (or generate them)
+    void *localM  = matrixAlloc((size_t)localRows * cols * elementBytes(), "local M");
+    void *localT  = matrixAlloc((size_t)ownedCols * rows * elementBytes(), "local T");
+    void *sendCol = matrixAlloc(localRows * elementBytes(), "column buffer");
+    if (((!localM || !sendCol) && localRows > 0) || (!localT && ownedCols > 0)) {
+        fprintf(stderr, "Rank %d: Could not allocate localM/localT\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    scatterRows(matrix, localM, rows, cols);
+
+    // 2) Gather column c on its owner, straight into its row of localT
+    int owner = 0;
+    for (int c = 0; c < cols; c++)
+    {
+        while (c >= slabStart(cols, owner + 1)) {
+            owner++;
+        }
+
+        transposeTile(ELEM(localM, c), cols, sendCol, 1, localRows, 1);
+
+        MPI_Gatherv(sendCol, localRows, elementMPIType(),
+                    rank == owner ? ELEM(localT, (size_t)(c - ownedStart) * rows) : NULL,
+                    counts, displs, elementMPIType(),
+                    owner, MPI_COMM_WORLD);
+    }
+
+    matrixFree(sendCol);
+    matrixFree(localM);
+    free(displs);
+    free(counts);
+
+    part->rowOffset = ownedStart;
+    part->colOffset = 0;
+    part->localRows = ownedCols;
+    part->localCols = rows;
+    part->ld        = rows;
+    part->data      = localT;
+}
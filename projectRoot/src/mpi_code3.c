@@ -3,200 +3,262 @@
 #include <stdlib.h>
 #include <string.h>
 #include "matrix_operations.h"
+#include "simd_kernels.h"
+#include "mpi_common.h"
+#include "matrix_alloc.h"
 
-int checkSymMPI3(float *matrix, int n)
+int checkSymMPI3(void *matrix, int n)
+{
+    return checkSymRowsMPI(matrix, n);
+}
+
+
+
+void matTransposeMPI3(void *matrix, void *transposed, int n)
+{
+    matTransposeMPI3Rect(matrix, transposed, n, n);
+}
+
+/*
+ rows x cols version: rank r owns its row slab of M (rows
+ [slabStart(rows, r), slabStart(rows, r+1))) and its row slab of T, so the
+ block exchanged between ranks r and k is r's rows of M by k's rows of T.
+ Any rows, cols and size work; slabs and blocks may be uneven.
+ Blocks are sent from localM and received into localT with derived
+ datatypes, so the exchange needs no pack/unpack buffers.
+ */
+void matTransposeMPI3Rect(void *matrix, void *transposed, int rows, int cols)
+{
+    LocalPart part;
+    matTransposeMPI3Dist(matrix, rows, cols, &part);
+
+    gatherRows(part.data, transposed, cols, rows);
+
+    freeLocalPart(&part);
+}
+
+/*
+ Steps 1-3 of matTransposeMPI3Rect: rank r keeps its row slab of T in
+ 'part' instead of gathering it.
+ */
+void matTransposeMPI3Dist(void *matrix, int rows, int cols, LocalPart *part)
 {
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    // --- 1) Broadcast the entire matrix ---
-    // Rank 0 already allocated and filled 'matrix'.
-    // Other ranks need to allocate memory for the full matrix.
-    if (rank != 0) {
-        matrix = (float *)malloc(n * n * sizeof(float));
+    int rowStart  = slabStart(rows, rank);
+    int colStart  = slabStart(cols, rank);
+    int localRows = slabStart(rows, rank + 1) - rowStart;   // rows of M here
+    int localCols = slabStart(cols, rank + 1) - colStart;   // rows of T here
+
+    // -------------------------------------------------
+    // 1) Scatter original matrix M to all ranks (or generate it locally)
+    //    Each rank gets localRows*cols elements
+    // -------------------------------------------------
+    void *localM = matrixAlloc((size_t)localRows * cols * elementBytes(), "local M");
+    if (rank == 0 && matrix == NULL && !localSourceEnabled()) {
+        fprintf(stderr,"matTransposeMPI: rank=0 has a null matrix pointer!\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
     }
+    scatterRows(matrix, localM, rows, cols);
 
-    double t0 = MPI_Wtime();
-    MPI_Bcast(matrix, n*n, MPI_FLOAT, 0, MPI_COMM_WORLD);
-
-    // --- 2) Local check for symmetry ---
-    // We'll divide rows among processes in a simple contiguous chunk manner:
-    int rowsPerProc = n / size;            
-    int remainder   = n % size;            // leftover rows if not divisible
-    int localStart, localEnd;
-
-    if (rank < remainder) {
-        // ranks [0..remainder-1] handle (rowsPerProc + 1) rows each
-        localStart = rank * (rowsPerProc + 1);
-        localEnd   = localStart + (rowsPerProc + 1);
-    } else {
-        // ranks [remainder..size-1] handle rowsPerProc each
-        localStart = remainder * (rowsPerProc + 1) 
-                     + (rank - remainder) * rowsPerProc;
-        localEnd   = localStart + rowsPerProc;
+    // -------------------------------------------------
+    // 2) Allocate space for local portion of T
+    //    store rows [colStart .. colStart+localCols) of T
+    //    => localCols*rows elements
+    // -------------------------------------------------
+    void *localT = matrixCalloc((size_t)localCols * rows, elementBytes(), "local T");
+    if (!localT && localCols > 0) {
+        fprintf(stderr, "Rank %d: Could not allocate localT\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
     }
 
-    int localSym = 1;
-    // For each row i in [localStart, localEnd), check columns j > i
-    for (int i = localStart; i < localEnd && localSym; i++) {
-        for (int j = i + 1; j < n; j++) {
-            if (matrix[i * n + j] != matrix[j * n + i]) {
-                localSym = 0;
-                break;
+    // -------------------------------------------------
+    // 3) Pairwise exchange sub-blocks
+    // -------------------------------------------------
+    for (int k = 0; k < size; k++)
+    {
+        int kRowStart = slabStart(rows, k);
+        int kColStart = slabStart(cols, k);
+        int kRows = slabStart(rows, k + 1) - kRowStart;   // rows of M on rank k
+        int kCols = slabStart(cols, k + 1) - kColStart;   // rows of T on rank k
+
+        if (k == rank)
+        {
+            // Diagonal block: transpose locally, no exchange needed
+            transposeBlockedThreads(ELEM(localM, colStart), cols, ELEM(localT, rowStart),
+                                    rows, localRows, localCols, 64);
+        }
+        else
+        {
+            MPI_Request req[2];
+            MPI_Status  stat[2];
+            int nreq = 0;
+
+            // Off-diagonal block exchange
+            // Global indices in T:
+            //   T[ colStart + c,   kRowStart + r ] = block_k[r, c]
+            // i.e. the received block lands transposed at column kRowStart of localT.
+            // Block k of the local slab as it sits in localM (no packing), and the
+            // "transposed column" type that stores the incoming kRows x localCols
+            // block transposed in localT (no unpacking)
+            int tag = 999;
+            if (localRows > 0 && kCols > 0) {
+                MPI_Datatype sendBlock = createBlockType(cols, localRows, kCols);
+                MPI_Isend(ELEM(localM, kColStart), 1, sendBlock, k, tag, MPI_COMM_WORLD,
+                          &req[nreq++]);
+                MPI_Type_free(&sendBlock);
+            }
+            if (kRows > 0 && localCols > 0) {
+                MPI_Datatype recvBlock = createTransposedBlockType(rows, kRows, localCols);
+                MPI_Irecv(ELEM(localT, kRowStart), 1, recvBlock, k, tag, MPI_COMM_WORLD,
+                          &req[nreq++]);
+                MPI_Type_free(&recvBlock);
             }
+
+            // Wait for completion
+            MPI_Waitall(nreq, req, stat);
         }
     }
 
-    // --- 3) Combine results ---
-    int globalSym = 1;
-    MPI_Allreduce(&localSym, &globalSym, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    matrixFree(localM);
 
-    double t1 = MPI_Wtime();
+    part->rowOffset = colStart;
+    part->colOffset = 0;
+    part->localRows = localCols;
+    part->localCols = rows;
+    part->ld        = rows;
+    part->data      = localT;
+}
 
-    // Print stats from rank 0
-    if (rank == 0) {
-        if (globalSym)
-            printf("Broadcast MPI: The matrix is symmetric.\n");
-        else
-            printf("Broadcast MPI: The matrix is NOT symmetric.\n");
-        printf("Time taken: %f s\n", (t1 - t0));
-    }
 
-    // If rank != 0, we allocated matrix for the broadcast
-    if (rank != 0) {
-        free(matrix);
-    }
-    return globalSym;
-}
 
+/*
+  In-place variant of matTransposeMPI3.
 
+         Rank 0 scatters and gathers with MPI_IN_PLACE, so its own row slab
+         is transposed directly inside 'matrix' and no n*n 'transposed'
+         buffer is ever allocated. Every rank still needs one send and one
+         receive block of at most localRows x maxRows, where maxRows is the
+         tallest slab. Slabs may be uneven: the block sent to rank k
+         (localRows x kRows) frees exactly the space that the transposed
+         block received from k takes.
 
-void matTransposeMPI3(float *matrix, float *transposed, int n)
+ matrix     [IN/OUT] On rank 0, the full n*n input, overwritten with its
+                     transpose. NULL on other ranks.
+ */
+void matTransposeInPlaceMPI3(void *matrix, int n)
 {
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    // We assume n is divisible by size
-    int localRows = n / size;
+    int rowStart  = slabStart(n, rank);
+    int localRows = slabStart(n, rank + 1) - rowStart;
+    int maxRows   = 0;
+    int *counts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    for (int r = 0; r < size; r++) {
+        int start = slabStart(n, r);
+        int rowsR = slabStart(n, r + 1) - start;
+        counts[r] = rowsR * n;
+        displs[r] = start * n;
+        if (rowsR > maxRows) maxRows = rowsR;
+    }
 
-    // -------------------------------------------------
-    // 1) Scatter original matrix M to all ranks
-    //    Each rank gets localRows*n floats
-    // -------------------------------------------------
-    float *localM = (float *)malloc(localRows * n * sizeof(float));
     if (rank == 0 && matrix == NULL) {
-        fprintf(stderr,"matTransposeMPI: rank=0 has a null matrix pointer!\n");
+        fprintf(stderr,"matTransposeInPlaceMPI3: rank=0 has a null matrix pointer!\n");
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
-    MPI_Scatter(
-         matrix,
-         localRows * n,
-         MPI_FLOAT,
-         localM,
-         localRows * n,
-         MPI_FLOAT,
-         0,
-         MPI_COMM_WORLD
-    );
 
     // -------------------------------------------------
-    // 2) Allocate space for local portion of T
-    //    store rows [rank*localRows .. (rank+1)*localRows) of T
-    //    => also localRows*n floats
+    // 1) Scatter rows; rank 0 keeps its slab in place
     // -------------------------------------------------
-    float *localT = (float *)calloc(localRows * n, sizeof(float));
-    if (!localT) {
-        fprintf(stderr, "Rank %d: Could not allocate localT\n", rank);
-        MPI_Abort(MPI_COMM_WORLD, 1);
+    void *localM = matrix;
+    if (rank != 0) {
+        localM = matrixAlloc((size_t)localRows * n * elementBytes(), "local M");
+        if (!localM && localRows > 0) {
+            fprintf(stderr, "Rank %d: Could not allocate localM\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
     }
+    MPI_Scatterv(
+         matrix,
+         counts,
+         displs,
+         elementMPIType(),
+         rank == 0 ? MPI_IN_PLACE : localM,
+         counts[rank],
+         elementMPIType(),
+         0,
+         MPI_COMM_WORLD
+    );
 
-    // exchange sub-blocks of dimension localRows x localRows
-    // with each other rank 'k'. 
-    float *sendBuf = (float *)malloc(localRows * localRows * sizeof(float));
-    float *recvBuf = (float *)malloc(localRows * localRows * sizeof(float));
-    if (!sendBuf || !recvBuf) {
+    size_t blockElems = (size_t)localRows * maxRows;
+    void *sendBuf = matrixAlloc(blockElems * elementBytes(), "send buffer");
+    void *recvBuf = matrixAlloc(blockElems * elementBytes(), "recv buffer");
+    if ((!sendBuf || !recvBuf) && blockElems > 0) {
         fprintf(stderr, "Rank %d: Could not allocate sendBuf/recvBuf\n", rank);
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
 
     // -------------------------------------------------
-    // 3) Pairwise exchange sub-blocks
+    // 2) Pairwise exchange; block k of the slab is packed before it is
+    //    overwritten with the transposed block received from rank k
     // -------------------------------------------------
     for (int k = 0; k < size; k++)
     {
+        int colStart = slabStart(n, k);
+        int kRows = slabStart(n, k + 1) - colStart;
+
         if (k == rank)
         {
-            for (int r = 0; r < localRows; r++) {
-                for (int c = 0; c < localRows; c++) {
-
-                    int globalCol = rank * localRows + c;
-                    float val = localM[r * n + globalCol];
-                    
-                    float transVal = localM[c * n + (rank*localRows + r)];
-
-                    localT[r * n + globalCol] = transVal;
-                }
-            }
+            transposeBlockedInPlace(ELEM(localM, colStart), n, localRows, 64);
         }
-        else
+        else if (localRows > 0 && kRows > 0)
         {
-
-            int colStart = k * localRows;
+#pragma omp parallel for default(none) shared(sendBuf, localM, localRows, kRows, n, colStart)
             for (int r = 0; r < localRows; r++) {
-                for (int c = 0; c < localRows; c++) {
-                    int globalCol = colStart + c;
-                    sendBuf[r*localRows + c] = localM[r*n + globalCol];
-                }
+                memcpy(ELEM(sendBuf, (size_t)r * kRows), ELEM(localM, (size_t)r * n + colStart),
+                       kRows * elementBytes());
             }
 
             MPI_Request req[2];
             MPI_Status  stat[2];
 
+            // we send localRows x kRows and receive kRows x localRows
             int tag = 999;
-            MPI_Isend(sendBuf, localRows*localRows, MPI_FLOAT, k, tag, MPI_COMM_WORLD, &req[0]);
-            MPI_Irecv(recvBuf, localRows*localRows, MPI_FLOAT, k, tag, MPI_COMM_WORLD, &req[1]);
-
-            // Wait for completion
+            MPI_Isend(sendBuf, localRows*kRows, elementMPIType(), k, tag, MPI_COMM_WORLD, &req[0]);
+            MPI_Irecv(recvBuf, kRows*localRows, elementMPIType(), k, tag, MPI_COMM_WORLD, &req[1]);
             MPI_Waitall(2, req, stat);
 
-
-
-            // Off-diagonal block exchange
-            for (int r = 0; r < localRows; r++) {
-              for (int c = 0; c < localRows; c++) {
-                  float val = recvBuf[r*localRows + c];
-          
-                  // Global indices in T:
-                  //   T[ rank*localRows + c,   k*localRows + r ] = val
-                  int globalRow = rank * localRows + c; 
-                  int globalCol = k    * localRows + r;
-          
-                  // Convert globalRow -> localRow for localT
-                  int localRow = c; 
-                  // The column in localT is the same as globalCol
-                  localT[ localRow*n + globalCol ] = val;
-              }
-            }
-
+            transposeBlockedThreads(recvBuf, localRows, ELEM(localM, colStart), n,
+                                    kRows, localRows, 64);
         }
     }
 
-    free(sendBuf);
-    free(recvBuf);
+    matrixFree(sendBuf);
+    matrixFree(recvBuf);
 
-    MPI_Gather(
-         localT,
-         localRows * n,
-         MPI_FLOAT,
-         transposed,  
-         localRows * n,
-         MPI_FLOAT,
+    // -------------------------------------------------
+    // 3) Gather the transposed slabs back into 'matrix' on rank 0
+    // -------------------------------------------------
+    MPI_Gatherv(
+         rank == 0 ? MPI_IN_PLACE : localM,
+         counts[rank],
+         elementMPIType(),
+         matrix,
+         counts,
+         displs,
+         elementMPIType(),
          0,
          MPI_COMM_WORLD
     );
 
-    free(localM);
-    free(localT);
-}
\ No newline at end of file
+    if (rank != 0) {
+        matrixFree(localM);
+    }
+    free(displs);
+    free(counts);
+}
@@ -0,0 +1,178 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "matrix_operations.h"
+#include "simd_kernels.h"
+#include "matrix_alloc.h"
+
+void matTransposeMPI4(void *matrix, void *transposed, int n)
+{
+    matTransposeMPI4Rect(matrix, transposed, n, n);
+}
+
+/*
+ Same row layout as matTransposeMPI3Rect, but all exchanges are in flight
+ at once: every off-diagonal block is packed up front, all receives and
+ sends are posted on a staggered schedule (step k talks to rank+k and
+ rank-k, so no two ranks hit the same peer in the same step), the diagonal
+ block is transposed while the messages travel, and received blocks are
+ unpacked in arrival order with MPI_Waitany. With OMP_NUM_THREADS > 1 the
+ packing is shared by the rank's threads and the unpacking runs as tasks
+ next to the master thread that waits on the messages.
+ Any rows, cols and size: blocks are sized per peer from the row slabs.
+ */
+void matTransposeMPI4Rect(void *matrix, void *transposed, int rows, int cols)
+{
+    LocalPart part;
+    matTransposeMPI4Dist(matrix, rows, cols, &part);
+
+    // Gather the rows of T on rank 0
+    gatherRows(part.data, transposed, cols, rows);
+
+    freeLocalPart(&part);
+}
+
+/*
+ Everything but the final gather: rank r keeps its row slab of T in 'part'.
+ */
+void matTransposeMPI4Dist(void *matrix, int rows, int cols, LocalPart *part)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int rowStart  = slabStart(rows, rank);
+    int colStart  = slabStart(cols, rank);
+    int localRows = slabStart(rows, rank + 1) - rowStart;   // rows of M here
+    int localCols = slabStart(cols, rank + 1) - colStart;   // rows of T here
+
+    // -------------------------------------------------
+    // 1) Scatter original matrix M to all ranks (or generate it locally)
+    // -------------------------------------------------
+    if (rank == 0 && matrix == NULL && !localSourceEnabled()) {
+        fprintf(stderr,"matTransposeMPI4: rank=0 has a null matrix pointer!\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    void *localM = matrixAlloc((size_t)localRows * cols * elementBytes(), "local M");
+    void *localT = matrixAlloc((size_t)localCols * rows * elementBytes(), "local T");
+    if ((!localM && localRows > 0) || (!localT && localCols > 0)) {
+        fprintf(stderr, "Rank %d: Could not allocate localM/localT\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    scatterRows(matrix, localM, rows, cols);
+
+    // one send and one receive slot per peer, indexed by peer rank: we send
+    // peer k our rows x its slab of columns (localRows x kCols) and receive
+    // its rows x our columns (kRows x localCols)
+    // (slab bounds are tabulated here: only the master thread may call MPI)
+    int *rowSlab    = (int *)malloc((size + 1) * sizeof(int));
+    int *colSlab    = (int *)malloc((size + 1) * sizeof(int));
+    size_t *sendOff = (size_t *)malloc((size + 1) * sizeof(size_t));
+    size_t *recvOff = (size_t *)malloc((size + 1) * sizeof(size_t));
+    for (int k = 0; k <= size; k++) {
+        rowSlab[k] = slabStart(rows, k);
+        colSlab[k] = slabStart(cols, k);
+    }
+    sendOff[0] = recvOff[0] = 0;
+    for (int k = 0; k < size; k++) {
+        int kRows = rowSlab[k + 1] - rowSlab[k];
+        int kCols = colSlab[k + 1] - colSlab[k];
+        sendOff[k + 1] = sendOff[k] + (k == rank ? 0 : (size_t)localRows * kCols);
+        recvOff[k + 1] = recvOff[k] + (k == rank ? 0 : (size_t)kRows * localCols);
+    }
+
+    void *sendBuf = matrixAlloc((sendOff[size] + 1) * elementBytes(), "send buffer");
+    void *recvBuf = matrixAlloc((recvOff[size] + 1) * elementBytes(), "recv buffer");
+    MPI_Request *recvReq = (MPI_Request *)malloc(size * sizeof(MPI_Request));
+    MPI_Request *sendReq = (MPI_Request *)malloc(size * sizeof(MPI_Request));
+    int *recvFrom        = (int *)malloc(size * sizeof(int));
+    if (!sendBuf || !recvBuf || !recvReq || !sendReq || !recvFrom) {
+        fprintf(stderr, "Rank %d: Could not allocate exchange buffers\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    int tag = 999;
+
+    // Hybrid MPI+OpenMP: all threads pack, the master thread alone calls MPI
+    // (MPI_THREAD_FUNNELED) and hands the transposes to the other threads as
+    // tasks, so unpacking overlaps with waiting for the next block. (No
+    // default(none): MPI_COMM_WORLD and the MPI datatypes may be globals.)
+#pragma omp parallel shared(localM, localT, sendBuf, recvBuf, sendOff, recvOff, rowSlab, colSlab, \
+                            recvReq, sendReq, recvFrom, rank, size, rows, cols, rowStart, \
+                            colStart, localRows, localCols, tag)
+    {
+        // -------------------------------------------------
+        // 2) Post every receive, then pack and send every off-diagonal block
+        // -------------------------------------------------
+#pragma omp master
+        for (int k = 1; k < size; k++) {
+            int src = (rank - k + size) % size;
+            recvFrom[k - 1] = src;
+            MPI_Irecv(ELEM(recvBuf, recvOff[src]), (int)(recvOff[src + 1] - recvOff[src]),
+                      elementMPIType(), src, tag, MPI_COMM_WORLD, &recvReq[k - 1]);
+        }
+
+#pragma omp for collapse(2) schedule(static)
+        for (int k = 1; k < size; k++) {
+            for (int r = 0; r < localRows; r++) {
+                int dst = (rank + k) % size;
+                int dstStart = colSlab[dst];
+                int dstCols = colSlab[dst + 1] - dstStart;
+                memcpy(ELEM(sendBuf, sendOff[dst] + (size_t)r * dstCols),
+                       ELEM(localM, (size_t)r * cols + dstStart), dstCols * elementBytes());
+            }
+        }
+
+#pragma omp master
+        {
+            for (int k = 1; k < size; k++) {
+                int dst = (rank + k) % size;
+                MPI_Isend(ELEM(sendBuf, sendOff[dst]), (int)(sendOff[dst + 1] - sendOff[dst]),
+                          elementMPIType(), dst, tag, MPI_COMM_WORLD, &sendReq[k - 1]);
+            }
+
+            // -------------------------------------------------
+            // 3) Diagonal block: transpose locally while the exchange runs
+            // -------------------------------------------------
+#pragma omp task
+            transposeBlocked(ELEM(localM, colStart), cols, ELEM(localT, rowStart), rows,
+                             localRows, localCols, 64);
+
+            // -------------------------------------------------
+            // 4) Unpack blocks in whatever order they arrive
+            //    T[colStart + c, rowSlab[k] + r] = block_k[r, c]
+            // -------------------------------------------------
+            for (int done = 0; done < size - 1; done++) {
+                int idx;
+                MPI_Waitany(size - 1, recvReq, &idx, MPI_STATUS_IGNORE);
+                int k = recvFrom[idx];
+                int kRowStart = rowSlab[k];
+                int kRows = rowSlab[k + 1] - kRowStart;
+#pragma omp task firstprivate(k, kRowStart, kRows)
+                transposeBlocked(ELEM(recvBuf, recvOff[k]), localCols, ELEM(localT, kRowStart),
+                                 rows, kRows, localCols, 64);
+            }
+            MPI_Waitall(size - 1, sendReq, MPI_STATUSES_IGNORE);
+        }
+    }   // the closing barrier also waits for the unpack tasks
+
+    free(recvFrom);
+    free(sendReq);
+    free(recvReq);
+    matrixFree(sendBuf);
+    matrixFree(recvBuf);
+    free(recvOff);
+    free(sendOff);
+    free(colSlab);
+    free(rowSlab);
+
+    matrixFree(localM);
+
+    part->rowOffset = colStart;
+    part->colOffset = 0;
+    part->localRows = localCols;
+    part->localCols = rows;
+    part->ld        = rows;
+    part->data      = localT;
+}
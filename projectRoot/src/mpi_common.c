@@ -0,0 +1,825 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "mpi_common.h"
+#include "matrix_io.h"
+#include "utils.h"
+#include "simd_kernels.h"
+#include "matrix_alloc.h"
+
+MPI_Datatype elementMPIType(void)
+{
+    switch (elementType()) {
+    case ELEM_DOUBLE: return MPI_DOUBLE;
+    case ELEM_I8:     return MPI_INT8_T;
+    case ELEM_I16:    return MPI_INT16_T;
+    case ELEM_I32:    return MPI_INT32_T;
+    case ELEM_C64:    return MPI_C_FLOAT_COMPLEX;
+    default:          return MPI_FLOAT;
+    }
+}
+
+MPI_Datatype createBlockType(int ld, int rows, int cols)
+{
+    MPI_Datatype block;
+    MPI_Type_vector(rows, cols, ld, elementMPIType(), &block);
+    MPI_Type_commit(&block);
+    return block;
+}
+
+MPI_Datatype createTransposedBlockType(int ld, int rows, int cols)
+{
+    MPI_Datatype column, columnResized, block;
+
+    // one incoming row r -> column r of the destination (stride ld)
+    MPI_Type_vector(cols, 1, ld, elementMPIType(), &column);
+    // shrink its extent to one element so consecutive rows land in
+    // consecutive columns
+    MPI_Type_create_resized(column, 0, (MPI_Aint)elementBytes(), &columnResized);
+    MPI_Type_contiguous(rows, columnResized, &block);
+    MPI_Type_commit(&block);
+
+    MPI_Type_free(&column);
+    MPI_Type_free(&columnResized);
+    return block;
+}
+
+void transposeBlockedThreads(const void *src, int lds, void *dst, int ldd,
+                             int rows, int cols, int blockSize)
+{
+    size_t es = elementBytes();
+    int tileCols = (cols + blockSize - 1) / blockSize;
+    long tiles = (long)((rows + blockSize - 1) / blockSize) * tileCols;
+
+#pragma omp parallel for default(none) shared(src, lds, dst, ldd, rows, cols, blockSize, tileCols, tiles, es) \
+        schedule(static) if (!omp_in_parallel())
+    for (long t = 0; t < tiles; t++) {
+        int ii = (int)(t / tileCols) * blockSize;
+        int jj = (int)(t % tileCols) * blockSize;
+        int imax = (ii + blockSize > rows) ? rows : (ii + blockSize);
+        int jmax = (jj + blockSize > cols) ? cols : (jj + blockSize);
+
+        transposeTile((const char *)src + ((size_t)ii * lds + jj) * es, lds,
+                      (char *)dst + ((size_t)jj * ldd + ii) * es, ldd, imax - ii, jmax - jj);
+    }
+}
+
+void collectLocalParts(const LocalPart *part, void *transposed, int tRows, int tCols)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // 1) rank 0 learns where every part goes
+    int desc[4] = { part->rowOffset, part->colOffset, part->localRows, part->localCols };
+    int *all = NULL;
+    if (rank == 0) {
+        all = (int *)malloc(4 * size * sizeof(int));
+    }
+    MPI_Gather(desc, 4, MPI_INT, all, 4, MPI_INT, 0, MPI_COMM_WORLD);
+
+    // 2) every part travels once, straight into its place in 'transposed'
+    MPI_Datatype sendType = createBlockType(part->ld, part->localRows, part->localCols);
+    int tag = 2;
+
+    if (rank == 0) {
+        for (int r = 0; r < size; r++) {
+            int *d = &all[4 * r];
+            if (d[2] == 0 || d[3] == 0) continue;
+            if (d[0] < 0 || d[1] < 0 || d[0] + d[2] > tRows || d[1] + d[3] > tCols) {
+                fprintf(stderr, "collectLocalParts: part of rank %d (%d x %d at %d, %d) "
+                                "exceeds the %d x %d result\n", r, d[2], d[3], d[0], d[1],
+                        tRows, tCols);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+
+            MPI_Datatype recvType = createBlockType(tCols, d[2], d[3]);
+            void *dst = ELEM(transposed, (size_t)d[0] * tCols + d[1]);
+            if (r == 0) {
+                MPI_Sendrecv(part->data, 1, sendType, 0, tag,
+                             dst, 1, recvType, 0, tag,
+                             MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            } else {
+                MPI_Recv(dst, 1, recvType, r, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            }
+            MPI_Type_free(&recvType);
+        }
+        free(all);
+    } else if (part->localRows > 0 && part->localCols > 0) {
+        MPI_Send(part->data, 1, sendType, 0, tag, MPI_COMM_WORLD);
+    }
+
+    MPI_Type_free(&sendType);
+}
+
+void freeLocalPart(LocalPart *part)
+{
+    matrixFree(part->data);
+    part->data = NULL;
+}
+
+static int maxInt(int a, int b) { return a > b ? a : b; }
+static int minInt(int a, int b) { return a < b ? a : b; }
+
+static int localInit     = 0;
+static int localSeed     = 0;
+static int localSymmetric = 0;
+
+static MPI_File inputFile = MPI_FILE_NULL;
+static const char *inputPath;
+static int inputRows, inputCols;
+static MPI_Offset inputOffset;   // payload start (0 for raw files)
+static int inputOrder, inputTile;  // ORDER_*, tile edge of ORDER_TILED
+
+// Binary matrix files: the header, and per tile the checksum contributions
+// and the number of elements of everything this rank has read so far
+// (NULL for raw files, which have nothing to verify)
+static MatrixFileHeader inputHeader;
+static uint64_t *inputSums, *inputCounts;
+
+void setLocalInit(int seed, int symmetric)
+{
+    localInit      = 1;
+    localSeed      = seed;
+    localSymmetric = symmetric;
+}
+
+void setInputFile(const char *path, int rows, int cols, const MatrixFileHeader *header)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Offset dataOffset = header ? (MPI_Offset)header->dataOffset : 0;
+    int order    = header ? (int)header->order : ORDER_ROW_MAJOR;
+    int tileSize = header ? (int)header->tileSize : 0;
+
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_RDONLY, MPI_INFO_NULL,
+                      &inputFile) != MPI_SUCCESS) {
+        if (rank == 0) fprintf(stderr, "Cannot open input file '%s'\n", path);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // tiled payloads hold whole, zero-padded edge tiles
+    MPI_Offset elements = (MPI_Offset)rows * cols;
+    if (order == ORDER_TILED) {
+        MPI_Offset tilesI = (rows + tileSize - 1) / tileSize;
+        MPI_Offset tilesJ = (cols + tileSize - 1) / tileSize;
+        elements = tilesI * tilesJ * tileSize * (MPI_Offset)tileSize;
+    }
+
+    MPI_Offset bytes;
+    MPI_File_get_size(inputFile, &bytes);
+    if (bytes != dataOffset + elements * (MPI_Offset)elementBytes()) {
+        if (rank == 0) {
+            fprintf(stderr, "Input file '%s' has %lld bytes, expected %d x %d %s elements\n",
+                    path, (long long)bytes, rows, cols, elementTypeName(elementType()));
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (header) {
+        inputHeader = *header;
+        inputSums   = (uint64_t *)calloc(header->numTiles, sizeof(uint64_t));
+        inputCounts = (uint64_t *)calloc(header->numTiles, sizeof(uint64_t));
+    }
+
+    localInit = 1;
+    inputPath   = path;
+    inputRows   = rows;
+    inputCols   = cols;
+    inputOffset = dataOffset;
+    inputOrder  = order;
+    inputTile   = tileSize;
+}
+
+void addInputTileSums(const void *block, int ld, int rowOffset, int colOffset,
+                      int rows, int cols)
+{
+    if (!inputSums || rows <= 0 || cols <= 0) return;
+    matrixTileSums(&inputHeader, block, ld, rowOffset, colOffset, rows, cols, inputSums);
+
+    int ts = (int)inputHeader.tileSize;
+    long tilesJ = (inputCols + ts - 1) / ts;
+    for (int I = rowOffset / ts; I <= (rowOffset + rows - 1) / ts; I++) {
+        int h = minInt((I + 1) * ts, rowOffset + rows) - maxInt(I * ts, rowOffset);
+        for (int J = colOffset / ts; J <= (colOffset + cols - 1) / ts; J++) {
+            int w = minInt((J + 1) * ts, colOffset + cols) - maxInt(J * ts, colOffset);
+            inputCounts[I * tilesJ + J] += (uint64_t)h * w;
+        }
+    }
+}
+
+/*
+ The reads of all ranks add up to whole passes over M (the symmetry check
+ and the transpose each make one), so every tile has been read some whole
+ number of times k and its summed contributions must be k times the stored
+ checksum. Tiles read partially or not at all are left out.
+ */
+static void verifyInputSums(void)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int numTiles = (int)inputHeader.numTiles;
+    uint64_t *sums   = NULL, *counts = NULL, *stored = NULL;
+    if (rank == 0) {
+        sums   = (uint64_t *)malloc(numTiles * sizeof(uint64_t));
+        counts = (uint64_t *)malloc(numTiles * sizeof(uint64_t));
+        stored = (uint64_t *)malloc(numTiles * sizeof(uint64_t));
+    }
+    MPI_Reduce(inputSums, sums, numTiles, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(inputCounts, counts, numTiles, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    // the checksum table sits right after the header, outside every view so far
+    MPI_File_set_view(inputFile, 0, MPI_BYTE, MPI_BYTE, "native", MPI_INFO_NULL);
+    if (rank == 0) {
+        MPI_File_read_at(inputFile, sizeof(MatrixFileHeader), stored, numTiles, MPI_UINT64_T,
+                         MPI_STATUS_IGNORE);
+
+        int ts = (int)inputHeader.tileSize;
+        int tilesJ = (inputCols + ts - 1) / ts;
+        long bad = 0, first = 0;
+        for (int t = 0; t < numTiles; t++) {
+            int h = minInt(ts, inputRows - (t / tilesJ) * ts);
+            int w = minInt(ts, inputCols - (t % tilesJ) * ts);
+            uint64_t area = (uint64_t)h * w;
+            if (counts[t] == 0 || counts[t] % area != 0) continue;
+            if (sums[t] != counts[t] / area * stored[t] && bad++ == 0) first = t;
+        }
+        if (bad) {
+            fprintf(stderr, "'%s': %ld of %d tile checksums do not match (first: tile %ld, %ld)\n",
+                    inputPath, bad, numTiles, first / tilesJ, first % tilesJ);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    free(stored);
+    free(counts);
+    free(sums);
+}
+
+void closeInputFile(void)
+{
+    if (inputFile != MPI_FILE_NULL) {
+        if (inputSums) {
+            verifyInputSums();
+            free(inputSums);
+            free(inputCounts);
+            inputSums = inputCounts = NULL;
+        }
+        MPI_File_close(&inputFile);
+        localInit = 0;   // back to scattering from rank 0
+    }
+}
+
+int localSourceEnabled(void)
+{
+    return localInit;
+}
+
+int inputFileEnabled(void)
+{
+    return inputFile != MPI_FILE_NULL;
+}
+
+void readInputView(MPI_Datatype filetype, void *buf, int count)
+{
+    MPI_File_set_view(inputFile, inputOffset, elementMPIType(), filetype, "native", MPI_INFO_NULL);
+    MPI_File_read_all(inputFile, buf, count, elementMPIType(), MPI_STATUS_IGNORE);
+}
+
+/*
+ View of a rows x cols rectangle at (rowOffset, colOffset) of a row-major
+ gRows x gCols file; an empty rectangle gets a plain element view (a
+ subarray needs at least one element per dimension).
+ */
+static MPI_Datatype createRectView(int gRows, int gCols, int rowOffset, int colOffset,
+                                   int rows, int cols)
+{
+    MPI_Datatype view = elementMPIType();
+    if (rows > 0 && cols > 0) {
+        int sizes[2]    = { gRows, gCols };
+        int subsizes[2] = { rows, cols };
+        int starts[2]   = { rowOffset, colOffset };
+        MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, elementMPIType(),
+                                 &view);
+        MPI_Type_commit(&view);
+    }
+    return view;
+}
+
+/*
+ Column-major file: the rows x cols block of M is the cols x rows block at
+ (colOffset, rowOffset) of the file's row-major T, read contiguously and
+ transposed into place.
+ */
+static void loadColMajorBlock(void *block, int ld, int rowOffset, int colOffset,
+                              int rows, int cols)
+{
+    int empty = (rows <= 0 || cols <= 0);
+    MPI_Datatype view = createRectView(inputCols, inputRows, colOffset, rowOffset, cols, rows);
+    MPI_File_set_view(inputFile, inputOffset, elementMPIType(), view, "native", MPI_INFO_NULL);
+
+    void *staging = empty ? NULL : matrixAlloc((size_t)rows * cols * elementBytes(), "input part");
+    MPI_Datatype memBlock = empty ? elementMPIType() : createBlockType(rows, cols, rows);
+    MPI_File_read_all(inputFile, staging, empty ? 0 : 1, memBlock, MPI_STATUS_IGNORE);
+
+    if (!empty) {
+        transposeBlockedThreads(staging, rows, block, ld, cols, rows, 64);
+        MPI_Type_free(&memBlock);
+        MPI_Type_free(&view);
+        matrixFree(staging);
+    }
+}
+
+/*
+ Tiled file: every tile touching the block is read whole. Within a tile
+ row of the grid the tiles are consecutive in the file, so the view is a
+ subarray of tiles and each tile is one contiguous run. The part of each
+ tile that falls inside the block is then copied out by the rank's threads.
+ */
+static void loadTiledBlock(void *block, int ld, int rowOffset, int colOffset,
+                           int rows, int cols)
+{
+    int ts = inputTile;
+    int empty = (rows <= 0 || cols <= 0);
+    int I0 = 0, J0 = 0, spanI = 0, spanJ = 0;
+    if (!empty) {
+        I0 = rowOffset / ts;
+        J0 = colOffset / ts;
+        spanI = (rowOffset + rows - 1) / ts - I0 + 1;
+        spanJ = (colOffset + cols - 1) / ts - J0 + 1;
+    }
+
+    // one tile as a type (ts rows of ts elements: ts * ts may not fit an int)
+    MPI_Datatype tileRow, tile, view;
+    MPI_Type_contiguous(ts, elementMPIType(), &tileRow);
+    MPI_Type_contiguous(ts, tileRow, &tile);
+    MPI_Type_commit(&tile);
+    view = tile;
+    if (!empty) {
+        int sizes[2]    = { (inputRows + ts - 1) / ts, (inputCols + ts - 1) / ts };
+        int subsizes[2] = { spanI, spanJ };
+        int starts[2]   = { I0, J0 };
+        MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, tile, &view);
+        MPI_Type_commit(&view);
+    }
+    MPI_File_set_view(inputFile, inputOffset, tile, view, "native", MPI_INFO_NULL);
+
+    size_t tileBytes = (size_t)ts * ts * elementBytes();
+    long tiles = (long)spanI * spanJ;
+    void *staging = empty ? NULL : matrixAlloc(tiles * tileBytes, "input tiles");
+    MPI_File_read_all(inputFile, staging, (int)tiles, tile, MPI_STATUS_IGNORE);
+
+    if (!empty) {
+        size_t es = elementBytes();
+#pragma omp parallel for default(none) \
+        shared(staging, block, ld, rowOffset, colOffset, rows, cols, ts, I0, J0, spanJ, tiles, \
+               tileBytes, es) schedule(static)
+        for (long t = 0; t < tiles; t++) {
+            int i0 = (I0 + (int)(t / spanJ)) * ts, j0 = (J0 + (int)(t % spanJ)) * ts;
+            int rStart = (i0 > rowOffset) ? i0 : rowOffset;
+            int cStart = (j0 > colOffset) ? j0 : colOffset;
+            int rEnd = (i0 + ts < rowOffset + rows) ? i0 + ts : rowOffset + rows;
+            int cEnd = (j0 + ts < colOffset + cols) ? j0 + ts : colOffset + cols;
+            const char *src = (const char *)staging + (size_t)t * tileBytes;
+            for (int r = rStart; r < rEnd; r++) {
+                memcpy(ELEM(block, (size_t)(r - rowOffset) * ld + (cStart - colOffset)),
+                       src + ((size_t)(r - i0) * ts + (cStart - j0)) * es,
+                       (size_t)(cEnd - cStart) * es);
+            }
+        }
+        MPI_Type_free(&view);
+        matrixFree(staging);
+    }
+    MPI_Type_free(&tile);
+    MPI_Type_free(&tileRow);
+}
+
+void loadLocalBlock(void *block, int ld, int rowOffset, int colOffset,
+                    int rows, int cols)
+{
+    if (inputFile == MPI_FILE_NULL) {
+        initializeMatrixBlock(block, ld, rowOffset, colOffset, rows, cols,
+                              localSeed, localSymmetric);
+        return;
+    }
+    if (inputOrder == ORDER_COL_MAJOR) {
+        loadColMajorBlock(block, ld, rowOffset, colOffset, rows, cols);
+    } else if (inputOrder == ORDER_TILED) {
+        loadTiledBlock(block, ld, rowOffset, colOffset, rows, cols);
+    } else {
+        int empty = (rows <= 0 || cols <= 0);
+        MPI_Datatype view = createRectView(inputRows, inputCols, rowOffset, colOffset, rows, cols);
+        MPI_File_set_view(inputFile, inputOffset, elementMPIType(), view, "native", MPI_INFO_NULL);
+
+        // the block may sit inside a wider local array
+        MPI_Datatype memBlock = empty ? elementMPIType() : createBlockType(ld, rows, cols);
+        MPI_File_read_all(inputFile, block, empty ? 0 : 1, memBlock, MPI_STATUS_IGNORE);
+
+        if (!empty) {
+            MPI_Type_free(&memBlock);
+            MPI_Type_free(&view);
+        }
+    }
+    addInputTileSums(block, ld, rowOffset, colOffset, rows, cols);
+}
+
+void writeLocalPart(const char *path, const LocalPart *part, int tRows, int tCols, int tileSize)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    MPI_File file;
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                      &file) != MPI_SUCCESS) {
+        if (rank == 0) fprintf(stderr, "Cannot open output file '%s'\n", path);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // ---- 1) header: the tile checksums of all parts are summed on rank 0,
+    //         which writes them in front of the payload
+    MPI_Offset dataOffset = 0;
+    if (tileSize > 0) {
+        MatrixFileHeader header;
+        matrixFileInitHeader(&header, tRows, tCols, ORDER_ROW_MAJOR, tileSize);
+        dataOffset = (MPI_Offset)header.dataOffset;
+
+        uint64_t *sums  = (uint64_t *)calloc(header.numTiles, sizeof(uint64_t));
+        uint64_t *total = (rank == 0) ? (uint64_t *)calloc(header.numTiles, sizeof(uint64_t)) : NULL;
+        matrixTileSums(&header, part->data, part->ld, part->rowOffset, part->colOffset,
+                       part->localRows, part->localCols, sums);
+        MPI_Reduce(sums, total, (int)header.numTiles, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+        if (rank == 0) {
+            MPI_File_write_at(file, 0, &header, sizeof header, MPI_BYTE, MPI_STATUS_IGNORE);
+            MPI_File_write_at(file, sizeof header, total, (int)header.numTiles, MPI_UINT64_T,
+                              MPI_STATUS_IGNORE);
+        }
+        free(sums);
+        free(total);
+    }
+
+    // ---- 2) payload: every rank writes its part in place
+    // (set_size also drops whatever a longer, older file had beyond T)
+    MPI_File_set_size(file, dataOffset + (MPI_Offset)tRows * tCols * (MPI_Offset)elementBytes());
+
+    int empty = (part->localRows <= 0 || part->localCols <= 0);
+    MPI_Datatype view = createRectView(tRows, tCols, part->rowOffset, part->colOffset,
+                                       part->localRows, part->localCols);
+    MPI_File_set_view(file, dataOffset, elementMPIType(), view, "native", MPI_INFO_NULL);
+
+    MPI_Datatype memBlock = empty ? elementMPIType()
+                                  : createBlockType(part->ld, part->localRows, part->localCols);
+    MPI_File_write_all(file, part->data, empty ? 0 : 1, memBlock, MPI_STATUS_IGNORE);
+
+    if (!empty) {
+        MPI_Type_free(&memBlock);
+        MPI_Type_free(&view);
+    }
+    MPI_File_close(&file);
+}
+
+static int slabAlign = 1;
+
+void setSlabAlign(int align)
+{
+    slabAlign = (align > 1) ? align : 1;
+}
+
+int slabStart(int n, int r)
+{
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    return slabStartOf(n, r, size);
+}
+
+int slabStartOf(int n, int r, int size)
+{
+    long start = (long)n * r / size;
+    if (slabAlign > 1) {
+        // nearest multiple of the alignment; rounding keeps slabs in order
+        start = (start + slabAlign / 2) / slabAlign * slabAlign;
+    }
+    return (start < n && r < size) ? (int)start : n;
+}
+
+// Element counts and displacements of every rank's slab, for the v-collectives
+static void slabCounts(int n, int rowLen, int *counts, int *displs)
+{
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    for (int r = 0; r < size; r++) {
+        int start = slabStart(n, r);
+        counts[r] = (slabStart(n, r + 1) - start) * rowLen;
+        displs[r] = start * rowLen;
+    }
+}
+
+void scatterRows(const void *matrix, void *localM, int rows, int cols)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (localInit) {
+        int start = slabStart(rows, rank);
+        loadLocalBlock(localM, cols, start, 0, slabStart(rows, rank + 1) - start, cols);
+        return;
+    }
+
+    int *counts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    slabCounts(rows, cols, counts, displs);
+
+    MPI_Scatterv(matrix, counts, displs, elementMPIType(),
+                 localM, counts[rank], elementMPIType(),
+                 0, MPI_COMM_WORLD);
+
+    free(displs);
+    free(counts);
+}
+
+void gatherRows(const void *localT, void *transposed, int tRows, int tCols)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int *counts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    slabCounts(tRows, tCols, counts, displs);
+
+    MPI_Gatherv(localT, counts[rank], elementMPIType(),
+                transposed, counts, displs, elementMPIType(),
+                0, MPI_COMM_WORLD);
+
+    free(displs);
+    free(counts);
+}
+
+/*****************************************************************************
+ * Distributed symmetry check
+ *****************************************************************************/
+
+#define TAG_SYM  11
+#define SYM_TILE 64    // rows i transposed and compared at a time
+#define SYM_BAND 256   // columns i of every mirror exchanged per round
+
+typedef struct { int r0, r1, c0, c1; } Rect;
+
+static Rect rectOf(const int *desc)
+{
+    Rect r = { desc[0], desc[0] + desc[2], desc[1], desc[1] + desc[3] };
+    return r;
+}
+
+/*
+ Part of 'owner' that mirrors 'checker': rows j in owner.rows & checker.cols,
+ columns i in owner.cols & checker.rows. Empty (returns 0) if it holds no
+ pair with i < j, i.e. nothing in the checker's upper triangle.
+ */
+static int mirrorRegion(Rect owner, Rect checker, Rect *region)
+{
+    region->r0 = maxInt(owner.r0, checker.c0);
+    region->r1 = minInt(owner.r1, checker.c1);
+    region->c0 = maxInt(owner.c0, checker.r0);
+    region->c1 = minInt(owner.c1, checker.r1);
+    return region->r0 < region->r1 && region->c0 < region->c1
+        && region->c0 + 1 < region->r1;
+}
+
+/*
+ Round k of a mirror exchange: columns i in [c0 + k SYM_BAND, ...) and only
+ the rows j > i of them. Owner and checker derive the same band from the
+ same region, so both know which rounds carry a message. Empty (returns 0)
+ once the region is used up.
+ */
+static int mirrorBand(Rect region, int k, Rect *band)
+{
+    band->c0 = region.c0 + k * SYM_BAND;
+    band->c1 = minInt(band->c0 + SYM_BAND, region.c1);
+    band->r0 = maxInt(region.r0, band->c0 + 1);
+    band->r1 = region.r1;
+    return band->c0 < band->c1 && band->r0 < band->r1;
+}
+
+/*
+ 'mirror' holds M[j][i] for j in region rows, i in region columns (leading
+ dimension mld); compare with our M[i][j] for every i < j. Works through
+ SYM_TILE rows of i at a time. Returns 0 at the first mismatch.
+ */
+static int compareMirror(const LocalPart *part, Rect region, const void *mirror, int mld,
+                         void *scratch)
+{
+    int w = region.r1 - region.r0;   // j range
+
+    for (int ii = region.c0; ii < region.c1; ii += SYM_TILE) {
+        int imax = minInt(ii + SYM_TILE, region.c1);
+        // scratch[i][j] = M[j][i]
+        transposeBlocked(ELEM(mirror, ii - region.c0), mld, scratch, w, w, imax - ii, 64);
+
+        for (int i = ii; i < imax; i++) {
+            int j0 = maxInt(region.r0, i + 1);
+            if (j0 >= region.r1) continue;
+            const void *mine = ELEM(part->data, (size_t)(i - part->rowOffset) * part->ld
+                                               + (j0 - part->colOffset));
+            if (!elementsEqual(mine, ELEM(scratch, (size_t)(i - ii) * w + (j0 - region.r0)),
+                               region.r1 - j0)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+int checkSymDistributed(const LocalPart *part, int n)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // 1) everyone learns every rectangle, and with them every mirror region:
+    //    the ones we check (received from their owner) and the ones we own
+    int mine[4] = { part->rowOffset, part->colOffset, part->localRows, part->localCols };
+    int *all = (int *)malloc(4 * size * sizeof(int));
+    MPI_Allgather(mine, 4, MPI_INT, all, 4, MPI_INT, MPI_COMM_WORLD);
+    Rect me = rectOf(mine);
+
+    Rect *checkRegion    = (Rect *)malloc(size * sizeof(Rect));
+    Rect *ownRegion      = (Rect *)malloc(size * sizeof(Rect));
+    int *checkPeer       = (int *)malloc(size * sizeof(int));
+    int *ownPeer         = (int *)malloc(size * sizeof(int));
+    void **recvBuf       = (void **)calloc(size, sizeof(void *));
+    Rect *recvBand       = (Rect *)malloc(size * sizeof(Rect));
+    MPI_Request *recvReq = (MPI_Request *)malloc(size * sizeof(MPI_Request));
+    MPI_Request *sendReq = (MPI_Request *)malloc(size * sizeof(MPI_Request));
+    void *scratch        = matrixAlloc((size_t)SYM_TILE * n * elementBytes(), "check scratch");
+    int checks = 0, owns = 0;
+    for (int b = 0; b < size; b++) {
+        if (b == rank) continue;
+        if (mirrorRegion(rectOf(&all[4 * b]), me, &checkRegion[checks])) checkPeer[checks++] = b;
+        if (mirrorRegion(me, rectOf(&all[4 * b]), &ownRegion[owns]))     ownPeer[owns++] = b;
+    }
+
+    // 2) the mirror of our own diagonal part is local
+    int sym = 1;
+    Rect self;
+    if (mirrorRegion(me, me, &self)) {
+        const void *src = ELEM(part->data, (size_t)(self.r0 - me.r0) * part->ld + (self.c0 - me.c0));
+        sym = compareMirror(part, self, src, part->ld, scratch);
+    }
+
+    // 3) exchange the remote mirrors one band per round. Each round opens
+    //    with an agreement on whether any rank has found a mismatch (or has
+    //    bands left), so after an early exit no further message is posted
+    //    and nothing is left unmatched.
+    for (int k = 0; ; k++) {
+        int more = 0;
+        Rect band;
+        for (int c = 0; c < checks && !more; c++) more = mirrorBand(checkRegion[c], k, &band);
+        for (int o = 0; o < owns && !more; o++)   more = mirrorBand(ownRegion[o], k, &band);
+        int state[2] = { !sym, more }, agreed[2];
+        MPI_Allreduce(state, agreed, 2, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+        if (agreed[0]) sym = 0;
+        if (agreed[0] || !agreed[1]) break;
+
+        // ---- 3a) receive band k of every mirror we check
+        int recvCount = 0, sendCount = 0;
+        for (int c = 0; c < checks; c++) {
+            if (!mirrorBand(checkRegion[c], k, &band)) continue;
+            int h = band.r1 - band.r0, w = band.c1 - band.c0;
+            recvBuf[recvCount]  = matrixAlloc((size_t)h * w * elementBytes(), "check mirror");
+            recvBand[recvCount] = band;
+            MPI_Irecv(recvBuf[recvCount], h * w, elementMPIType(), checkPeer[c], TAG_SYM,
+                      MPI_COMM_WORLD, &recvReq[recvCount]);
+            recvCount++;
+        }
+
+        // ---- 3b) send band k of every mirror we own, in place
+        for (int o = 0; o < owns; o++) {
+            if (!mirrorBand(ownRegion[o], k, &band)) continue;
+            MPI_Datatype block = createBlockType(part->ld, band.r1 - band.r0, band.c1 - band.c0);
+            const void *src = ELEM(part->data, (size_t)(band.r0 - me.r0) * part->ld
+                                               + (band.c0 - me.c0));
+            MPI_Isend(src, 1, block, ownPeer[o], TAG_SYM, MPI_COMM_WORLD, &sendReq[sendCount++]);
+            MPI_Type_free(&block);  // freed once the send completes
+        }
+
+        // ---- 3c) compare the bands as they arrive; after a mismatch the
+        //          rest of this round is only completed
+        for (int done = 0; done < recvCount; done++) {
+            int idx;
+            MPI_Waitany(recvCount, recvReq, &idx, MPI_STATUS_IGNORE);
+            if (sym) {
+                Rect region = recvBand[idx];
+                sym = compareMirror(part, region, recvBuf[idx], region.c1 - region.c0, scratch);
+            }
+            matrixFree(recvBuf[idx]);
+        }
+        MPI_Waitall(sendCount, sendReq, MPI_STATUSES_IGNORE);
+    }
+
+    matrixFree(scratch);
+    free(sendReq);
+    free(recvReq);
+    free(recvBand);
+    free(recvBuf);
+    free(ownPeer);
+    free(checkPeer);
+    free(ownRegion);
+    free(checkRegion);
+    free(all);
+
+    return sym;
+}
+
+static void reportCheck(int globalSym, double seconds)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) {
+        if (globalSym)
+            printf("Distributed MPI: The matrix is symmetric.\n");
+        else
+            printf("Distributed MPI: The matrix is NOT symmetric.\n");
+        printf("Time taken: %f s\n", seconds);
+    }
+}
+
+int checkSymRowsMPI(const void *matrix, int n)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    double t0 = MPI_Wtime();
+
+    LocalPart part;
+    part.rowOffset = slabStart(n, rank);
+    part.colOffset = 0;
+    part.localRows = slabStart(n, rank + 1) - part.rowOffset;
+    part.localCols = n;
+    part.ld        = n;
+    part.data      = matrixAlloc((size_t)part.localRows * n * elementBytes(), "local M");
+
+    scatterRows(matrix, part.data, n, n);
+
+    int globalSym = checkSymDistributed(&part, n);
+    reportCheck(globalSym, MPI_Wtime() - t0);
+
+    freeLocalPart(&part);
+    return globalSym;
+}
+
+int checkSymBlocksMPI(const void *matrix, int n)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int sqrtP = 1;
+    while ((sqrtP + 1) * (sqrtP + 1) <= size) sqrtP++;
+    if (sqrtP * sqrtP != size || n % sqrtP != 0) {
+        return checkSymRowsMPI(matrix, n);
+    }
+
+    double t0 = MPI_Wtime();
+
+    int b = n / sqrtP;
+    LocalPart part;
+    part.rowOffset = (rank / sqrtP) * b;
+    part.colOffset = (rank % sqrtP) * b;
+    part.localRows = b;
+    part.localCols = b;
+    part.ld        = b;
+    part.data      = matrixAlloc((size_t)b * b * elementBytes(), "local M");
+
+    // rank 0 sends every block straight out of 'matrix'
+    if (localInit) {
+        loadLocalBlock(part.data, b, part.rowOffset, part.colOffset, b, b);
+    } else {
+        MPI_Datatype block = createBlockType(n, b, b);
+        if (rank == 0) {
+            for (int r = 0; r < size; r++) {
+                const void *src = ELEM(matrix, (size_t)(r / sqrtP) * b * n + (size_t)(r % sqrtP) * b);
+                if (r == 0) {
+                    MPI_Sendrecv(src, 1, block, 0, TAG_SYM, part.data, b * b, elementMPIType(), 0,
+                                 TAG_SYM, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                } else {
+                    MPI_Send(src, 1, block, r, TAG_SYM, MPI_COMM_WORLD);
+                }
+            }
+        } else {
+            MPI_Recv(part.data, b * b, elementMPIType(), 0, TAG_SYM, MPI_COMM_WORLD,
+                     MPI_STATUS_IGNORE);
+        }
+        MPI_Type_free(&block);
+    }
+
+    int globalSym = checkSymDistributed(&part, n);
+    reportCheck(globalSym, MPI_Wtime() - t0);
+
+    freeLocalPart(&part);
+    return globalSym;
+}
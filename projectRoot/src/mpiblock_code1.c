@@ -4,77 +4,79 @@
 #include <math.h>
 #include <string.h>
 #include "matrix_operations.h"
+#include "mpi_common.h"
+#include "matrix_alloc.h"
 
 
-int checkSymBlockMPI1(float *matrix, int n)
+int checkSymBlockMPI1(void *matrix, int n)
+{
+    return checkSymBlocksMPI(matrix, n);
+}
+
+
+
+void matTransposeBlockMPI1(void *matrix, void *transposed, int n)
+{
+    matTransposeBlockMPI1Rect(matrix, transposed, n, n);
+}
+
+/*
+ rows x cols version: the sqrtP x sqrtP process grid splits M into
+ (rows/sqrtP) x (cols/sqrtP) blocks; block (i,j) lands transposed at
+ block position (j,i) of the cols x rows result.
+ Blocks are described with derived datatypes, and the local transpose is
+ done by the receive datatype (see createTransposedBlockType).
+ */
+void matTransposeBlockMPI1Rect(void *matrix, void *transposed, int rows, int cols)
 {
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    // --- 1) Broadcast the entire matrix ---
-    // Rank 0 already allocated and filled 'matrix'.
-    // Other ranks need to allocate memory for the full matrix.
-    if (rank != 0) {
-        matrix = (float *)malloc(n * n * sizeof(float));
-    }
-
-    double t0 = MPI_Wtime();
-    MPI_Bcast(matrix, n*n, MPI_FLOAT, 0, MPI_COMM_WORLD);
-
-    // --- 2) Local check for symmetry ---
-    // We'll divide rows among processes in a simple contiguous chunk manner:
-    int rowsPerProc = n / size;            
-    int remainder   = n % size;            // leftover rows if not divisible
-    int localStart, localEnd;
-
-    if (rank < remainder) {
-        // ranks [0..remainder-1] handle (rowsPerProc + 1) rows each
-        localStart = rank * (rowsPerProc + 1);
-        localEnd   = localStart + (rowsPerProc + 1);
-    } else {
-        // ranks [remainder..size-1] handle rowsPerProc each
-        localStart = remainder * (rowsPerProc + 1) 
-                     + (rank - remainder) * rowsPerProc;
-        localEnd   = localStart + rowsPerProc;
-    }
-
-    int localSym = 1;
-    // For each row i in [localStart, localEnd), check columns j > i
-    for (int i = localStart; i < localEnd && localSym; i++) {
-        for (int j = i + 1; j < n; j++) {
-            if (matrix[i * n + j] != matrix[j * n + i]) {
-                localSym = 0;
-                break;
-            }
-        }
-    }
+    LocalPart part;
+    matTransposeBlockMPI1Dist(matrix, rows, cols, &part);
 
-    // --- 3) Combine results ---
-    int globalSym = 1;
-    MPI_Allreduce(&localSym, &globalSym, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    int sqrtP = (int)(sqrt((double)size));
+    int blockRows = rows / sqrtP;
+    int blockCols = cols / sqrtP;
+    int blockCount = blockRows * blockCols;
 
-    double t1 = MPI_Wtime();
+    // transposed block as it sits in 'transposed'
+    MPI_Datatype dstBlock = createBlockType(rows, blockCols, blockRows);
 
-    // Print stats from rank 0
+    // 6) Rank 0 receives every transposed block directly into its
+    //    (j,i) position of 'transposed'
     if (rank == 0) {
-        if (globalSym)
-            printf("Broadcast MPI: The matrix is symmetric.\n");
-        else
-            printf("Broadcast MPI: The matrix is NOT symmetric.\n");
-        printf("Time taken: %f s\n", (t1 - t0));
-    }
+        for (int i = 0; i < sqrtP; i++) {
+            for (int j = 0; j < sqrtP; j++) {
+                int sourceRank = i*sqrtP + j;
+                void *dst = ELEM(transposed, (size_t)j * blockCols * rows + (size_t)i * blockRows);
 
-    // If rank != 0, we allocated matrix for the broadcast
-    if (rank != 0) {
-        free(matrix);
+                if (sourceRank == 0) {
+                    MPI_Sendrecv(part.data, blockCount, elementMPIType(), 0, 1,
+                                 dst, 1, dstBlock, 0, 1,
+                                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                } else {
+                    MPI_Recv(dst, 1, dstBlock,
+                             sourceRank, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                }
+            }
+        }
+    } 
+    else {
+        MPI_Send(part.data, blockCount, elementMPIType(),
+                 0, 1, MPI_COMM_WORLD);
     }
-    return globalSym;
-}
-
 
+    MPI_Type_free(&dstBlock);
+    freeLocalPart(&part);
+}
 
-void matTransposeBlockMPI1(float *matrix, float *transposed, int n)
+/*
+ Steps 1-5 of matTransposeBlockMPI1Rect: rank (i,j) keeps its transposed
+ block, which is block (j,i) of T, in 'part' instead of sending it to rank 0.
+ */
+void matTransposeBlockMPI1Dist(void *matrix, int rows, int cols, LocalPart *part)
 {
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -90,109 +92,76 @@ void matTransposeBlockMPI1(float *matrix, float *transposed, int n)
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
 
-    // 2) Check that n is divisible by sqrtP
-    if (n % sqrtP != 0) {
+    // 2) Check that rows and cols are divisible by sqrtP
+    if (rows % sqrtP != 0 || cols % sqrtP != 0) {
         if (rank == 0) {
             fprintf(stderr,
-                "[Error] n=%d not divisible by sqrtP=%d\n", n, sqrtP);
+                "[Error] %dx%d not divisible by sqrtP=%d\n", rows, cols, sqrtP);
         }
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
 
-    // 3) Each process will have a local block of size blockSize x blockSize
-    int blockSize = n / sqrtP;
+    // 3) Each process will have a local block of size blockRows x blockCols
+    int blockRows = rows / sqrtP;
+    int blockCols = cols / sqrtP;
+    int blockCount = blockRows * blockCols;
 
-    // 4) Compute 2D coordinates of this rank in the process grid
-    int rowCoord = rank / sqrtP;  // integer division
-    int colCoord = rank % sqrtP;
-
-    // 5) Allocate local block of size blockSize x blockSize
-    float *localBlock = (float *)malloc(blockSize * blockSize * sizeof(float));
+    // 4) Allocate the local block, already stored transposed
+    //    (blockCols x blockRows)
+    void *localBlock = matrixAlloc(blockCount * elementBytes(), "local T");
     if (!localBlock) {
         fprintf(stderr, "Rank %d: Could not allocate localBlock\n", rank);
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
 
-    // 6) Rank 0 sends the appropriate block to each process; or self-copy if rank=0
-    if (rank == 0) {
+    // Sub-block of M as it sits in 'matrix', and the same block received
+    // transposed
+    MPI_Datatype srcBlock   = createBlockType(cols, blockRows, blockCols);
+    MPI_Datatype transBlock = createTransposedBlockType(blockRows, blockRows, blockCols);
+
+    // 5) Rank 0 sends every block straight out of 'matrix'; the receive
+    //    type transposes it on arrival, so no user-level copy happens
+    //    (rank 0's own block goes through MPI_Sendrecv to itself)
+    //    With --local-init or --input each rank loads its block and sends it to
+    //    itself through the same transposing receive type
+    if (localSourceEnabled()) {
+        void *loaded = matrixAlloc(blockCount * elementBytes(), "local M");
+        loadLocalBlock(loaded, blockCols, (rank / sqrtP) * blockRows,
+                       (rank % sqrtP) * blockCols, blockRows, blockCols);
+        MPI_Sendrecv(loaded, blockCount, elementMPIType(), rank, 0,
+                     localBlock, 1, transBlock, rank, 0,
+                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        matrixFree(loaded);
+    }
+    else if (rank == 0) {
         for (int i = 0; i < sqrtP; i++) {
             for (int j = 0; j < sqrtP; j++) {
                 int destRank = i * sqrtP + j;
-                float *tempBuf = (float *)malloc(blockSize * blockSize * sizeof(float));
-                for (int r = 0; r < blockSize; r++) {
-                    for (int c = 0; c < blockSize; c++) {
-                        int globalRow = i * blockSize + r;
-                        int globalCol = j * blockSize + c;
-                        tempBuf[r * blockSize + c] =
-                            matrix[globalRow * n + globalCol];
-                    }
-                }
+                const void *block = ELEM(matrix, (size_t)i * blockRows * cols + (size_t)j * blockCols);
 
                 if (destRank == 0) {
-                    memcpy(localBlock, tempBuf, blockSize * blockSize * sizeof(float));
+                    MPI_Sendrecv(block, 1, srcBlock, 0, 0,
+                                 localBlock, 1, transBlock, 0, 0,
+                                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
                 } else {
-                    MPI_Send(tempBuf, blockSize*blockSize, MPI_FLOAT,
-                             destRank, 0, MPI_COMM_WORLD);
+                    MPI_Send(block, 1, srcBlock, destRank, 0, MPI_COMM_WORLD);
                 }
-                free(tempBuf);
             }
         }
     } 
     else {
-        MPI_Recv(localBlock, blockSize*blockSize, MPI_FLOAT,
+        MPI_Recv(localBlock, 1, transBlock,
                  0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
     }
 
-    // 7) Each process transposes its local block in place
-    //    localBlock[r,c] => localBlock[c,r]
-    //    Easiest is to do an out-of-place transpose if you want clarity
-    float *tempTranspose = (float *)malloc(blockSize * blockSize * sizeof(float));
-    for (int r = 0; r < blockSize; r++) {
-        for (int c = 0; c < blockSize; c++) {
-            tempTranspose[c * blockSize + r] = localBlock[r * blockSize + c];
-        }
-    }
-    memcpy(localBlock, tempTranspose, blockSize * blockSize * sizeof(float));
-    free(tempTranspose);
-
-    if (rank == 0) {
-        for (int i = 0; i < sqrtP; i++) {
-            for (int j = 0; j < sqrtP; j++) {
-                int sourceRank = i*sqrtP + j;
-                int transposeBlockRow = j;  
-                int transposeBlockCol = i; 
-
-                if (sourceRank == 0) {
-                    for (int r = 0; r < blockSize; r++) {
-                        for (int c = 0; c < blockSize; c++) {
-                            int globalRow = transposeBlockRow * blockSize + r;
-                            int globalCol = transposeBlockCol * blockSize + c;
-                            transposed[globalRow * n + globalCol] =
-                                localBlock[r * blockSize + c];
-                        }
-                    }
-                } else {
-                    float *tempBuf = (float *)malloc(blockSize * blockSize * sizeof(float));
-                    MPI_Recv(tempBuf, blockSize*blockSize, MPI_FLOAT,
-                             sourceRank, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-                    for (int r = 0; r < blockSize; r++) {
-                        for (int c = 0; c < blockSize; c++) {
-                            int globalRow = transposeBlockRow*blockSize + r;
-                            int globalCol = transposeBlockCol*blockSize + c;
-                            transposed[globalRow * n + globalCol] =
-                                tempBuf[r * blockSize + c];
-                        }
-                    }
-                    free(tempBuf);
-                }
-            }
-        }
-    } 
-    else {
-        MPI_Send(localBlock, blockSize*blockSize, MPI_FLOAT,
-                 0, 1, MPI_COMM_WORLD);
-    }
+    MPI_Type_free(&srcBlock);
+    MPI_Type_free(&transBlock);
 
-    free(localBlock);
+    // rank (i,j) holds block (j,i) of T
+    part->rowOffset = (rank % sqrtP) * blockCols;
+    part->colOffset = (rank / sqrtP) * blockRows;
+    part->localRows = blockCols;
+    part->localCols = blockRows;
+    part->ld        = blockRows;
+    part->data      = localBlock;
 }
@@ -4,84 +4,85 @@
 #include <math.h>
 #include <string.h>
 #include "matrix_operations.h"
+#include "mpi_common.h"
+#include "matrix_alloc.h"
 
-int checkSymBlockMPI3(float *matrix, int n)
+int checkSymBlockMPI3(void *matrix, int n)
+{
+    return checkSymBlocksMPI(matrix, n);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void matTransposeBlockMPI3(void *matrix, void *transposed, int n)
+{
+    matTransposeBlockMPI3Rect(matrix, transposed, n, n);
+}
+
+/*
+ rows x cols version: blocks are (rows/sqrtP) x (cols/sqrtP); the block of
+ rank (i,j) is copied back as a (cols/sqrtP) x (rows/sqrtP) block at (j,i).
+ Blocks travel as derived datatypes straight from/to the global matrices;
+ only the local transpose uses the register-tile kernels.
+ */
+void matTransposeBlockMPI3Rect(void *matrix, void *transposed, int rows, int cols)
 {
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    // --- 1) Broadcast the entire matrix ---
-    // Rank 0 already allocated and filled 'matrix'.
-    // Other ranks need to allocate memory for the full matrix.
-    if (rank != 0) {
-        matrix = (float *)malloc(n * n * sizeof(float));
-    }
+    LocalPart part;
+    matTransposeBlockMPI3Dist(matrix, rows, cols, &part);
 
-    double t0 = MPI_Wtime();
-    MPI_Bcast(matrix, n*n, MPI_FLOAT, 0, MPI_COMM_WORLD);
+    int sqrtP = (int) sqrt((double) size);
+    int blockRows = rows / sqrtP;
+    int blockCols = cols / sqrtP;
+    int blockCount = blockRows * blockCols;
 
-    // --- 2) Local check for symmetry ---
-    // We'll divide rows among processes in a simple contiguous chunk manner:
-    int rowsPerProc = n / size;            
-    int remainder   = n % size;            // leftover rows if not divisible
-    int localStart, localEnd;
+    // transposed block as it sits in 'transposed'
+    MPI_Datatype dstBlock = createBlockType(rows, blockCols, blockRows);
 
-    if (rank < remainder) {
-        // ranks [0..remainder-1] handle (rowsPerProc + 1) rows each
-        localStart = rank * (rowsPerProc + 1);
-        localEnd   = localStart + (rowsPerProc + 1);
-    } else {
-        // ranks [remainder..size-1] handle rowsPerProc each
-        localStart = remainder * (rowsPerProc + 1) 
-                     + (rank - remainder) * rowsPerProc;
-        localEnd   = localStart + rowsPerProc;
-    }
+    // ------------------------------------------------------------------
+    // 4) Gathering: rank 0 receives each transposed block directly into
+    //               its spot in the "transposed" array
+    // ------------------------------------------------------------------
+    if (rank == 0) {
+        for (int i = 0; i < sqrtP; i++) {
+            for (int j = 0; j < sqrtP; j++) {
+                int sourceRank = i*sqrtP + j;
+                void *dst = ELEM(transposed, (size_t)j * blockCols * rows + (size_t)i * blockRows);
 
-    int localSym = 1;
-    // For each row i in [localStart, localEnd), check columns j > i
-    for (int i = localStart; i < localEnd && localSym; i++) {
-        for (int j = i + 1; j < n; j++) {
-            if (matrix[i * n + j] != matrix[j * n + i]) {
-                localSym = 0;
-                break;
+                if (sourceRank == 0) {
+                    MPI_Sendrecv(part.data, blockCount, elementMPIType(), 0, 1,
+                                 dst, 1, dstBlock, 0, 1,
+                                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                } else {
+                    MPI_Recv(dst, 1, dstBlock,
+                             sourceRank, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                }
             }
         }
+    } else {
+        MPI_Send(part.data, blockCount, elementMPIType(),
+                 0, 1, MPI_COMM_WORLD);
     }
 
-    // --- 3) Combine results ---
-    int globalSym = 1;
-    MPI_Allreduce(&localSym, &globalSym, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
-
-    double t1 = MPI_Wtime();
-
-    // Print stats from rank 0
-    if (rank == 0) {
-        if (globalSym)
-            printf("Broadcast MPI: The matrix is symmetric.\n");
-        else
-            printf("Broadcast MPI: The matrix is NOT symmetric.\n");
-        printf("Time taken: %f s\n", (t1 - t0));
-    }
-
-    // If rank != 0, we allocated matrix for the broadcast
-    if (rank != 0) {
-        free(matrix);
-    }
-    return globalSym;
+    MPI_Type_free(&dstBlock);
+    freeLocalPart(&part);
 }
-
-
-////////////////////////////////////////////////////////////////////////////////////////////
-
-void matTransposeBlockMPI3(float *matrix, float *transposed, int n)
+/*
+ Steps 1-3 of matTransposeBlockMPI3Rect: rank (i,j) keeps its transposed
+ block, which is block (j,i) of T, in 'part' instead of sending it to rank 0.
+ */
+void matTransposeBlockMPI3Dist(void *matrix, int rows, int cols, LocalPart *part)
 {
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
     // -------------------------
-    // 1) Check sqrt(p) divides n
+    // 1) Check sqrt(p) divides rows and cols
     // -------------------------
     int sqrtP = (int) sqrt((double) size);
     if (sqrtP * sqrtP != size) {
@@ -91,115 +92,74 @@ void matTransposeBlockMPI3(float *matrix, float *transposed, int n)
         }
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
-    if (n % sqrtP != 0) {
+    if (rows % sqrtP != 0 || cols % sqrtP != 0) {
         if (rank == 0) {
             fprintf(stderr,
-                    "[Error] n=%d not divisible by sqrtP=%d!\n", n, sqrtP);
+                    "[Error] %dx%d not divisible by sqrtP=%d!\n", rows, cols, sqrtP);
         }
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
 
 
-    int blockSize = n / sqrtP;
-
-    int rowCoord = rank / sqrtP;  
-    int colCoord = rank % sqrtP;
+    int blockRows = rows / sqrtP;
+    int blockCols = cols / sqrtP;
+    int blockCount = blockRows * blockCols;
 
-    // local buffer for storing one block (blockSize x blockSize)
-    float *localBlock = (float*)malloc(blockSize * blockSize * sizeof(float));
+    // local buffer for storing one block (blockRows x blockCols)
+    void *localBlock = matrixAlloc(blockCount * elementBytes(), "local M");
     if (!localBlock) {
         fprintf(stderr, "Rank %d: could not allocate localBlock!\n", rank);
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
 
+    // Sub-block of M as it sits in 'matrix'
+    MPI_Datatype srcBlock = createBlockType(cols, blockRows, blockCols);
+
     // ------------------------------------------------------------------
-    // 2) Distribution: rank 0 extracts each (i,j) block and sends it out
+    // 2) Distribution: rank 0 sends each (i,j) block straight out of
+    //    'matrix' with the block datatype, no staging copy
+    //    (with --local-init or --input each rank loads its own block instead)
     // ------------------------------------------------------------------
-    if (rank == 0) {
+    if (localSourceEnabled()) {
+        loadLocalBlock(localBlock, blockCols, (rank / sqrtP) * blockRows,
+                       (rank % sqrtP) * blockCols, blockRows, blockCols);
+    }
+    else if (rank == 0) {
         for (int i = 0; i < sqrtP; i++) {
             for (int j = 0; j < sqrtP; j++) {
                 int destRank = i * sqrtP + j;
-                float *tempBuf = (float*)malloc(blockSize * blockSize * sizeof(float));
-                if (!tempBuf) {
-                    fprintf(stderr, "Rank 0: could not allocate tempBuf!\n");
-                    MPI_Abort(MPI_COMM_WORLD, 1);
-                }
-
-                for (int r = 0; r < blockSize; r++) {
-                    int globalRow = i*blockSize + r;
-                    memcpy(
-                        &tempBuf[r*blockSize],                 // destination
-                        &matrix[globalRow * n + (j*blockSize)],// source
-                        blockSize * sizeof(float)
-                    );
-                }
+                const void *block = ELEM(matrix, (size_t)i * blockRows * cols + (size_t)j * blockCols);
 
                 if (destRank == 0) {
-                    memcpy(localBlock, tempBuf, blockSize*blockSize*sizeof(float));
+                    MPI_Sendrecv(block, 1, srcBlock, 0, 0,
+                                 localBlock, blockCount, elementMPIType(), 0, 0,
+                                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
                 } else {
-                    MPI_Send(tempBuf, blockSize*blockSize, MPI_FLOAT,
-                             destRank, 0, MPI_COMM_WORLD);
+                    MPI_Send(block, 1, srcBlock, destRank, 0, MPI_COMM_WORLD);
                 }
-
-                free(tempBuf);
             }
         }
     } else {
-        MPI_Recv(localBlock, blockSize*blockSize, MPI_FLOAT,
+        MPI_Recv(localBlock, blockCount, elementMPIType(),
                  0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
     }
 
     // ------------------------------------------
     // 3) Each rank transposes its local block
+    //    (now blockCols x blockRows)
     // ------------------------------------------
-    float *tmpTranspose = (float*)malloc(blockSize * blockSize * sizeof(float));
-    for (int r = 0; r < blockSize; r++) {
-        for (int c = 0; c < blockSize; c++) {
-            tmpTranspose[c*blockSize + r] = localBlock[r*blockSize + c];
-        }
-    }
-    memcpy(localBlock, tmpTranspose, blockSize*blockSize*sizeof(float));
-    free(tmpTranspose);
-
-    // ------------------------------------------------------------------
-    // 4) Gathering: rank 0 collects the transposed blocks from each rank
-    //               placing them in "transposed" array in the correct spot
-    // ------------------------------------------------------------------
-
-    if (rank == 0) {
-        for (int i = 0; i < sqrtP; i++) {
-            for (int j = 0; j < sqrtP; j++) {
-                int sourceRank = i*sqrtP + j;
-                if (sourceRank == 0) {
-                    for (int r = 0; r < blockSize; r++) {
-                        int globalRow = j*blockSize + r;
-                        memcpy(
-                            &transposed[globalRow * n + (i*blockSize)], // dest
-                            &localBlock[r*blockSize],                   // src
-                            blockSize * sizeof(float)
-                        );
-                    }
-                } else {
-                    float *tempBuf = (float*)malloc(blockSize * blockSize * sizeof(float));
-                    MPI_Recv(tempBuf, blockSize*blockSize, MPI_FLOAT,
-                             sourceRank, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-      
-                    for (int r = 0; r < blockSize; r++) {
-                        int globalRow = j*blockSize + r;
-                        memcpy(
-                            &transposed[globalRow * n + (i*blockSize)],
-                            &tempBuf[r*blockSize],
-                            blockSize*sizeof(float)
-                        );
-                    }
-                    free(tempBuf);
-                }
-            }
-        }
-    } else {
-        MPI_Send(localBlock, blockSize*blockSize, MPI_FLOAT,
-                 0, 1, MPI_COMM_WORLD);
-    }
-    free(localBlock);
-}
\ No newline at end of file
+    void *localT = matrixAlloc(blockCount * elementBytes(), "local T");
+    transposeBlockedThreads(localBlock, blockCols, localT, blockRows,
+                            blockRows, blockCols, 64);
+
+    MPI_Type_free(&srcBlock);
+    matrixFree(localBlock);
+
+    // rank (i,j) holds block (j,i) of T
+    part->rowOffset = (rank % sqrtP) * blockCols;
+    part->colOffset = (rank / sqrtP) * blockRows;
+    part->localRows = blockCols;
+    part->localCols = blockRows;
+    part->ld        = blockRows;
+    part->data      = localT;
+}
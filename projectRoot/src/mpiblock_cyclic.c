@@ -0,0 +1,200 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "matrix_operations.h"
+#include "mpi_common.h"
+#include "matrix_alloc.h"
+
+/*
+ Number of rows (or columns) of an n-long dimension that process 'iproc'
+ of 'nprocs' owns when it is dealt out in blocks of nb, round-robin
+ (ScaLAPACK's NUMROC).
+ */
+static int numroc(int n, int nb, int iproc, int nprocs)
+{
+    int nblocks = n / nb;
+    int count = (nblocks / nprocs) * nb;
+    int extra = nblocks % nprocs;
+
+    if (iproc < extra) {
+        count += nb;
+    } else if (iproc == extra) {
+        count += n % nb;
+    }
+    return count;
+}
+
+/*
+ The local array of process (pr, pc) of a pRows x pCols grid when the
+ rows x cols matrix is distributed block-cyclically with nb x nb blocks,
+ as a committed type over the global row-major matrix. Receiving or
+ sending one of these with a contiguous buffer of localRows*localCols
+ elements on the other side moves a whole local array in one message.
+ */
+static MPI_Datatype createCyclicType(int rows, int cols, int nb,
+                                     int pRows, int pCols, int pr, int pc)
+{
+    int gsizes[2]   = { rows, cols };
+    int distribs[2] = { MPI_DISTRIBUTE_CYCLIC, MPI_DISTRIBUTE_CYCLIC };
+    int dargs[2]    = { nb, nb };
+    int psizes[2]   = { pRows, pCols };
+
+    MPI_Datatype type;
+    MPI_Type_create_darray(pRows * pCols, pr * pCols + pc, 2, gsizes, distribs, dargs,
+                           psizes, MPI_ORDER_C, elementMPIType(), &type);
+    MPI_Type_commit(&type);
+    return type;
+}
+
+void matTransposeBlockCyclicMPI(void *matrix, void *transposed, int n, int nb)
+{
+    matTransposeBlockCyclicMPIRect(matrix, transposed, n, n, nb);
+}
+
+/*
+ 2D block-cyclic transpose on any number of processes.
+
+ The ranks form a P x Q grid (MPI_Dims_create + MPI_Cart_create) and M is
+ dealt out in nb x nb blocks: block (I,J) lives on process (I%P, J%Q),
+ which stores its blocks as one local row-major array, as in ScaLAPACK.
+ Block (J,I) of T = M^T then belongs to process (I%P, J%Q) of the
+ transposed Q x P grid, i.e. to the same rank. The redistribution from the
+ P x Q layout of M to the Q x P layout of T therefore needs no messages:
+ every rank just transposes its local array. Scatter and gather use darray
+ datatypes, so rank 0 sends and receives each local array in one message.
+
+ Works for any rows, cols and rank count; partial edge blocks and ranks
+ without blocks are handled by the block-cyclic layout itself.
+ */
+void matTransposeBlockCyclicMPIRect(void *matrix, void *transposed, int rows, int cols, int nb)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (nb <= 0) {
+        if (rank == 0) {
+            fprintf(stderr, "[Error] block-cyclic block size must be positive (got %d)\n", nb);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // -------------------------------------------------
+    // 1) P x Q process grid, ranks in row-major order (no reordering, so
+    //    the darray grid ranks match)
+    // -------------------------------------------------
+    int dims[2]    = { 0, 0 };
+    int periods[2] = { 0, 0 };
+    MPI_Dims_create(size, 2, dims);
+
+    MPI_Comm grid;
+    MPI_Cart_create(MPI_COMM_WORLD, 2, dims, periods, 0, &grid);
+
+    int coords[2];
+    MPI_Cart_coords(grid, rank, 2, coords);
+    int P = dims[0], Q = dims[1];
+    int pr = coords[0], pc = coords[1];
+
+    int localRows = numroc(rows, nb, pr, P);
+    int localCols = numroc(cols, nb, pc, Q);
+    size_t localCount = (size_t)localRows * localCols;
+
+    void *localM = matrixAlloc(localCount * elementBytes(), "local M");
+    void *localT = matrixAlloc(localCount * elementBytes(), "local T");
+    if ((!localM || !localT) && localCount > 0) {
+        fprintf(stderr, "Rank %d: Could not allocate localM/localT\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // -------------------------------------------------
+    // 2) Distribute M block-cyclically (or read / generate the local blocks)
+    // -------------------------------------------------
+    if (inputFileEnabled()) {
+        // the darray type doubles as this rank's file view
+        MPI_Datatype cyclic = createCyclicType(rows, cols, nb, P, Q, pr, pc);
+        readInputView(cyclic, localM, (int)localCount);
+        MPI_Type_free(&cyclic);
+        for (int lr = 0; lr < localRows; lr += nb) {
+            int h = (localRows - lr < nb) ? localRows - lr : nb;
+            for (int lc = 0; lc < localCols; lc += nb) {
+                int w = (localCols - lc < nb) ? localCols - lc : nb;
+                addInputTileSums(ELEM(localM, (size_t)lr * localCols + lc), localCols,
+                                 ((lr / nb) * P + pr) * nb, ((lc / nb) * Q + pc) * nb, h, w);
+            }
+        }
+    }
+    else if (localSourceEnabled()) {
+        for (int lr = 0; lr < localRows; lr += nb) {
+            int I = (lr / nb) * P + pr;   // global block row
+            int h = (localRows - lr < nb) ? localRows - lr : nb;
+            for (int lc = 0; lc < localCols; lc += nb) {
+                int J = (lc / nb) * Q + pc;
+                int w = (localCols - lc < nb) ? localCols - lc : nb;
+                loadLocalBlock(ELEM(localM, (size_t)lr * localCols + lc), localCols,
+                               I * nb, J * nb, h, w);
+            }
+        }
+    } else {
+        if (rank == 0 && matrix == NULL) {
+            fprintf(stderr, "matTransposeBlockCyclicMPI: rank=0 has a null matrix pointer!\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (rank == 0) {
+            MPI_Request *req = (MPI_Request *)malloc(size * sizeof(MPI_Request));
+            MPI_Irecv(localM, (int)localCount, elementMPIType(), 0, 0, grid, &req[0]);
+            for (int r = 0; r < size; r++) {
+                int rc[2];
+                MPI_Cart_coords(grid, r, 2, rc);
+                MPI_Datatype cyclic = createCyclicType(rows, cols, nb, P, Q, rc[0], rc[1]);
+                if (r == 0) {
+                    MPI_Send(matrix, 1, cyclic, 0, 0, grid);
+                } else {
+                    MPI_Isend(matrix, 1, cyclic, r, 0, grid, &req[r]);
+                }
+                MPI_Type_free(&cyclic);
+            }
+            MPI_Waitall(size, req, MPI_STATUSES_IGNORE);
+            free(req);
+        } else {
+            MPI_Recv(localM, (int)localCount, elementMPIType(), 0, 0, grid, MPI_STATUS_IGNORE);
+        }
+    }
+
+    // -------------------------------------------------
+    // 3) P x Q -> Q x P: the local array of T is the transpose of the
+    //    local array of M (localCols x localRows)
+    // -------------------------------------------------
+    transposeBlockedThreads(localM, localCols, localT, localRows, localRows, localCols, 64);
+    matrixFree(localM);
+
+    // -------------------------------------------------
+    // 4) Gather T on rank 0: our local array is the block-cyclic part of
+    //    the cols x rows result at position (pc, pr) of the Q x P grid
+    // -------------------------------------------------
+    if (rank == 0) {
+        if (!transposed) {
+            fprintf(stderr, "Rank 0: 'transposed' is NULL\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        MPI_Request *req = (MPI_Request *)malloc(size * sizeof(MPI_Request));
+        MPI_Isend(localT, (int)localCount, elementMPIType(), 0, 1, grid, &req[0]);
+        for (int r = 0; r < size; r++) {
+            int rc[2];
+            MPI_Cart_coords(grid, r, 2, rc);
+            MPI_Datatype cyclic = createCyclicType(cols, rows, nb, Q, P, rc[1], rc[0]);
+            if (r == 0) {
+                MPI_Recv(transposed, 1, cyclic, 0, 1, grid, MPI_STATUS_IGNORE);
+            } else {
+                MPI_Irecv(transposed, 1, cyclic, r, 1, grid, &req[r]);
+            }
+            MPI_Type_free(&cyclic);
+        }
+        MPI_Waitall(size, req, MPI_STATUSES_IGNORE);
+        free(req);
+    } else {
+        MPI_Send(localT, (int)localCount, elementMPIType(), 0, 1, grid);
+    }
+
+    matrixFree(localT);
+    MPI_Comm_free(&grid);
+}
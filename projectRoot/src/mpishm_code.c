@@ -0,0 +1,172 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "matrix_operations.h"
+#include "simd_kernels.h"
+
+struct ShmMatrices {
+    int rows, cols;
+    MPI_Comm comm;           // the ranks of the node (all of MPI_COMM_WORLD)
+    int rank, size;
+    MPI_Win winM, winT;
+    void *matrix, *transposed;
+};
+
+/*
+ Shared window holding one slab of 'slabBytes' per rank. Segments are
+ contiguous (no alloc_shared_noncontig), so the first non-empty one starts
+ the whole array. The rank's own segment is zeroed here, so its pages are
+ placed on the rank's NUMA node. A passive-target epoch stays open on the
+ window for its lifetime: loads and stores need no further RMA calls.
+ */
+static void *allocateShared(MPI_Comm comm, size_t slabBytes, MPI_Win *win)
+{
+    void *mine;
+    MPI_Win_allocate_shared((MPI_Aint)slabBytes, elementBytes(), MPI_INFO_NULL, comm,
+                            &mine, win);
+    if (slabBytes > 0) memset(mine, 0, slabBytes);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, *win);
+
+    MPI_Aint bytes;
+    int dispUnit;
+    void *base;
+    MPI_Win_shared_query(*win, MPI_PROC_NULL, &bytes, &dispUnit, &base);
+    return base;
+}
+
+/*
+ Stores of every rank to M and T before the call are visible to every rank
+ after it: MPI_Win_sync on both sides of a barrier, as the shared memory
+ model asks for.
+ */
+static void shmSync(ShmMatrices *shm)
+{
+    MPI_Win_sync(shm->winM);
+    MPI_Win_sync(shm->winT);
+    MPI_Barrier(shm->comm);
+    MPI_Win_sync(shm->winM);
+    MPI_Win_sync(shm->winT);
+}
+
+ShmMatrices *shmMatricesCreate(int rows, int cols)
+{
+    int worldRank, worldSize;
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+
+    // ---- 1) the ranks that can share memory with us: all of them, or give up
+    MPI_Comm comm;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, worldRank, MPI_INFO_NULL, &comm);
+    int nodeSize;
+    MPI_Comm_size(comm, &nodeSize);
+    if (nodeSize != worldSize) {
+        if (worldRank == 0) {
+            fprintf(stderr, "-m mpi_shm needs all ranks on one node (%d of %d share rank 0's).\n",
+                    nodeSize, worldSize);
+        }
+        MPI_Comm_free(&comm);
+        return NULL;
+    }
+
+    ShmMatrices *shm = (ShmMatrices *)calloc(1, sizeof(ShmMatrices));
+    shm->rows = rows;
+    shm->cols = cols;
+    shm->comm = comm;
+    MPI_Comm_rank(comm, &shm->rank);
+    MPI_Comm_size(comm, &shm->size);
+
+    // ---- 2) M by row slabs of M, T by row slabs of T (the slab each rank writes)
+    int r = shm->rank, size = shm->size;
+    size_t es = elementBytes();
+    size_t slabM = (size_t)(slabStartOf(rows, r + 1, size) - slabStartOf(rows, r, size)) * cols * es;
+    size_t slabT = (size_t)(slabStartOf(cols, r + 1, size) - slabStartOf(cols, r, size)) * rows * es;
+    shm->matrix     = allocateShared(comm, slabM, &shm->winM);
+    shm->transposed = allocateShared(comm, slabT, &shm->winT);
+    shmSync(shm);
+    return shm;
+}
+
+void shmMatricesFree(ShmMatrices *shm)
+{
+    if (!shm) return;
+    MPI_Win_unlock_all(shm->winM);
+    MPI_Win_unlock_all(shm->winT);
+    MPI_Win_free(&shm->winM);
+    MPI_Win_free(&shm->winT);
+    MPI_Comm_free(&shm->comm);
+    free(shm);
+}
+
+void *shmInput(const ShmMatrices *shm)
+{
+    return shm->matrix;
+}
+
+void *shmOutput(const ShmMatrices *shm)
+{
+    return shm->transposed;
+}
+
+void shmLoadInput(ShmMatrices *shm)
+{
+    int start = slabStartOf(shm->rows, shm->rank, shm->size);
+    int count = slabStartOf(shm->rows, shm->rank + 1, shm->size) - start;
+    loadLocalBlock(ELEM(shm->matrix, (size_t)start * shm->cols), shm->cols, start, 0,
+                   count, shm->cols);
+    shmSync(shm);
+}
+
+/*
+ Square M only. blockSize row bands are dealt round-robin, which keeps the
+ shrinking upper triangle balanced; every row of a band is compared with
+ its mirrored column in place.
+ */
+int checkSymShm(ShmMatrices *shm, int blockSize)
+{
+    double t0 = MPI_Wtime();
+    shmSync(shm);
+
+    int n = shm->rows, sym = 1;
+    for (int ii = shm->rank * blockSize; ii < n && sym; ii += shm->size * blockSize) {
+        int imax = (ii + blockSize > n) ? n : ii + blockSize;
+        for (int i = ii; i < imax && sym; i++) {
+            sym = mirrorEqual(shm->matrix, n, i, i + 1, n);
+        }
+    }
+
+    int globalSym;
+    MPI_Allreduce(&sym, &globalSym, 1, MPI_INT, MPI_LAND, shm->comm);
+    if (shm->rank == 0) {
+        if (globalSym)
+            printf("Shared memory: The matrix is symmetric.\n");
+        else
+            printf("Shared memory: The matrix is NOT symmetric.\n");
+        printf("Time taken: %f s\n", MPI_Wtime() - t0);
+    }
+    return globalSym;
+}
+
+/*
+ Rank r writes rows [c0, c1) of T, i.e. transposes the rows x (c1 - c0)
+ column strip of M at column c0, with its OpenMP threads. Both sit in the
+ shared windows, so nothing is copied on the way in or out.
+ */
+void matTransposeShm(ShmMatrices *shm, int blockSize)
+{
+    // ---- 1) M as written by rank 0 (or by every rank for its slab)
+    shmSync(shm);
+
+    // ---- 2) our slab of T
+    int rows = shm->rows, cols = shm->cols;
+    int c0 = slabStartOf(cols, shm->rank, shm->size);
+    int c1 = slabStartOf(cols, shm->rank + 1, shm->size);
+    if (c1 > c0) {
+        transposeBlockedThreads(ELEM(shm->matrix, c0), cols,
+                                ELEM(shm->transposed, (size_t)c0 * rows), rows,
+                                rows, c1 - c0, blockSize);
+    }
+
+    // ---- 3) all of T, for rank 0's checksum and output
+    shmSync(shm);
+}
@@ -0,0 +1,230 @@
+#define _GNU_SOURCE  // sched_setaffinity, CPU_SET, syscall
+#include <ctype.h>
+#include <dirent.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <omp.h>
+#include "numa_placement.h"
+#include "simd_kernels.h"
+
+#define MAX_NODES        64
+#define REPORT_PAGES     4096    // pages sampled per matrix for the node shares
+#define REPORT_TILES     65536   // tiles sampled for the local fractions
+
+static int numaPlacement = 0;
+
+void setNumaPlacement(int enabled)
+{
+    numaPlacement = enabled;
+}
+
+int numaPlacementEnabled(void)
+{
+    return numaPlacement;
+}
+
+// NUMA node of a CPU from sysfs (cpuN/nodeK), 0 if it does not say.
+static int cpuNode(int cpu)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    if (!dir) return 0;
+
+    int node = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && isdigit((unsigned char)entry->d_name[4])) {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return (node < MAX_NODES) ? node : 0;
+}
+
+// Node of the CPU the calling thread runs on.
+static int currentNode(void)
+{
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) return 0;
+    return (node < MAX_NODES) ? (int)node : 0;
+}
+
+int pinThreads(void)
+{
+    if (omp_get_proc_bind() != omp_proc_bind_false) {
+        return 0;
+    }
+
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return 0;
+    }
+
+    // allowed CPUs ordered by node, then by id
+    int *cpus = (int *)malloc(CPU_SETSIZE * sizeof(int));
+    int *nodes = (int *)malloc(CPU_SETSIZE * sizeof(int));
+    int count = 0;
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (!CPU_ISSET(c, &allowed)) continue;
+        int node = cpuNode(c), k = count++;
+        while (k > 0 && nodes[k - 1] > node) {
+            cpus[k] = cpus[k - 1];
+            nodes[k] = nodes[k - 1];
+            k--;
+        }
+        cpus[k] = c;
+        nodes[k] = node;
+    }
+
+    // thread t gets CPU t * count / threads: threads spread evenly, and
+    // consecutive threads stay on the same node
+    int threads = omp_get_max_threads();
+#pragma omp parallel default(none) shared(cpus, count, threads)
+    {
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpus[(long)omp_get_thread_num() * count / threads], &one);
+        sched_setaffinity(0, sizeof(one), &one);
+    }
+
+    free(cpus);
+    free(nodes);
+    return 1;
+}
+
+// Zeroes the h x w tile at 'tile' (leading dimension ld).
+static void touchTile(void *tile, int ld, int h, int w)
+{
+    for (int r = 0; r < h; r++) {
+        memset(ELEM(tile, (size_t)r * ld), 0, (size_t)w * elementBytes());
+    }
+}
+
+void firstTouchOMP(void *matrix, void *transposed, int rows, int cols, int blockSize)
+{
+    int tileRows = (rows + blockSize - 1) / blockSize;
+    int tileCols = (cols + blockSize - 1) / blockSize;
+    long tiles = (long)tileRows * tileCols;
+
+    // the same flattened loop and static schedule as matTransposeOMPRect
+#pragma omp parallel for default(none) shared(matrix, transposed, rows, cols, blockSize, tileCols, tiles) \
+        schedule(static)
+    for (long t = 0; t < tiles; t++) {
+        int ii = (int)(t / tileCols) * blockSize;
+        int jj = (int)(t % tileCols) * blockSize;
+        int h = (ii + blockSize > rows) ? rows - ii : blockSize;
+        int w = (jj + blockSize > cols) ? cols - jj : blockSize;
+
+        if (matrix)     touchTile(ELEM(matrix, (size_t)ii * cols + jj), cols, h, w);
+        if (transposed) touchTile(ELEM(transposed, (size_t)jj * rows + ii), rows, w, h);
+    }
+}
+
+// Node of the page holding each address (move_pages without target nodes
+// only queries); -1 where the kernel does not say.
+static void pageNodes(void **pages, int count, int *status)
+{
+    if (syscall(SYS_move_pages, 0, (unsigned long)count, pages, NULL, status, 0) != 0) {
+        for (int i = 0; i < count; i++) status[i] = -1;
+    }
+}
+
+// Share of 'bytes' at 'base' per node, from up to REPORT_PAGES sampled pages.
+static void printPageShares(const char *label, const void *base, size_t bytes, int numNodes)
+{
+    if (!base || bytes == 0) return;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t pages = (bytes + page - 1) / page;
+    int samples = (pages < REPORT_PAGES) ? (int)pages : REPORT_PAGES;
+    void **addr = (void **)malloc(samples * sizeof(void *));
+    int *status = (int *)malloc(samples * sizeof(int));
+    for (int s = 0; s < samples; s++) {
+        addr[s] = (char *)base + (size_t)((double)s * pages / samples) * page;
+    }
+    pageNodes(addr, samples, status);
+
+    int counts[MAX_NODES] = { 0 }, unknown = 0;
+    for (int s = 0; s < samples; s++) {
+        if (status[s] >= 0 && status[s] < MAX_NODES) counts[status[s]]++;
+        else                                         unknown++;
+    }
+    printf("   %s pages per node:", label);
+    for (int node = 0; node < numNodes; node++) {
+        printf(" node%d=%.1f%%", node, 100.0 * counts[node] / samples);
+    }
+    if (unknown) printf(" unknown=%.1f%%", 100.0 * unknown / samples);
+    printf("\n");
+
+    free(addr);
+    free(status);
+}
+
+void reportPlacement(const void *matrix, const void *transposed, int rows, int cols,
+                     int blockSize)
+{
+    // ---- 1) nodes and where the threads run
+    int numNodes = 1;
+    for (int node = 0; node < MAX_NODES; node++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", node);
+        if (access(path, F_OK) == 0) numNodes = node + 1;
+    }
+
+    int threadsOnNode[MAX_NODES] = { 0 };
+#pragma omp parallel default(none) shared(threadsOnNode)
+    {
+        int node = currentNode();
+#pragma omp atomic
+        threadsOnNode[node]++;
+    }
+
+    const char *binding = (omp_get_proc_bind() != omp_proc_bind_false) ? "OMP_PROC_BIND"
+                                                                      : "--numa";
+    printf("   NUMA nodes: %d, %d threads pinned by %s:", numNodes, omp_get_max_threads(), binding);
+    for (int node = 0; node < numNodes; node++) {
+        printf(" node%d=%d", node, threadsOnNode[node]);
+    }
+    printf("\n");
+
+    // ---- 2) where the pages are
+    size_t bytes = (size_t)rows * cols * elementBytes();
+    printPageShares("M", matrix, bytes, numNodes);
+    printPageShares("T", transposed, bytes, numNodes);
+
+    // ---- 3) the kernel's view: is each thread's tile of M / of T local?
+    if (!matrix || !transposed) return;
+    int tileRows = (rows + blockSize - 1) / blockSize;
+    int tileCols = (cols + blockSize - 1) / blockSize;
+    long tiles = (long)tileRows * tileCols;
+    long step = (tiles + REPORT_TILES - 1) / REPORT_TILES;
+    long localM = 0, localT = 0, sampled = 0;
+
+#pragma omp parallel for default(none) \
+        shared(matrix, transposed, rows, cols, blockSize, tileCols, tiles, step) \
+        reduction(+:localM, localT, sampled) schedule(static)
+    for (long t = 0; t < tiles; t++) {
+        if (t % step != 0) continue;
+        int ii = (int)(t / tileCols) * blockSize;
+        int jj = (int)(t % tileCols) * blockSize;
+
+        void *pages[2] = { ELEM(matrix, (size_t)ii * cols + jj),
+                           ELEM(transposed, (size_t)jj * rows + ii) };
+        int status[2];
+        pageNodes(pages, 2, status);
+        int node = currentNode();
+        localM += (status[0] == node);
+        localT += (status[1] == node);
+        sampled++;
+    }
+    if (sampled > 0) {
+        printf("   Local tiles (M read / T written): %.1f%% / %.1f%%\n",
+               100.0 * localM / sampled, 100.0 * localT / sampled);
+    }
+}
@@ -1,71 +1,307 @@
+#include <mpi.h>
+#include <math.h>
 #include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "matrix_operations.h"
+#include "numa_placement.h"
+#include "simd_kernels.h"
+
+/**
+ * Maps k in [0, nb*(nb+1)/2) to the upper-triangle tile pair (bi, bj),
+ * bi <= bj, of an nb x nb tile grid, so triangular loops can be flattened
+ * into one parallel loop. Counting from the last tile row, row r holds
+ * r + 1 tiles and starts at r*(r+1)/2.
+ */
+static void triangleTile(long k, int nb, int *bi, int *bj)
+{
+    long kr = (long)nb * (nb + 1) / 2 - 1 - k;
+    long r  = (long)((sqrt(8.0 * (double)kr + 1.0) - 1.0) / 2.0);
+    while (r * (r + 1) / 2 > kr) r--;             // fix sqrt rounding
+    while ((r + 1) * (r + 2) / 2 <= kr) r++;
+
+    *bi = nb - 1 - (int)r;
+    *bj = nb - 1 - (int)(kr - r * (r + 1) / 2);
+}
+
+// Compares the upper-triangle part of one block with its mirror; stops at
+// the first mismatch.
+static int blockIsSymmetric(const void *matrix, int n, int ii, int jj, int imax, int jmax)
+{
+    for (int i = ii; i < imax; i++) {
+        int jStart = (i == ii) ? (i + 1) : jj;
+        if (!mirrorEqual(matrix, n, i, jStart, jmax)) {
+            return 0;
+        }
+    }
+    return 1;
+}
 
 /**
  * @brief Checks if an n x n matrix is symmetric using a block-based approach with OpenMP.
+ *
+ * The upper-triangle tile pairs are flattened into one loop with a dynamic
+ * schedule, so small n still feeds every thread and the short rows at the
+ * bottom of the triangle do not leave threads idle. The first thread to
+ * find a mismatch raises a shared flag; every thread reads it before each
+ * tile and skips the rest, so a non-symmetric matrix is not scanned to
+ * the end.
  */
-int checkSymOMP(float *matrix, int n)
+int checkSymOMP(void *matrix, int n, int blockSize)
 {
-    int blockSize = 64;
-    int symmetric = 1;
-
-#pragma omp parallel for default(none) shared(matrix, n, blockSize) reduction(&& : symmetric)
-    for (int ii = 0; ii < n; ii += blockSize) {
-        for (int jj = ii; jj < n; jj += blockSize) {
-            int imax = (ii + blockSize > n) ? n : (ii + blockSize);
-            int jmax = (jj + blockSize > n) ? n : (jj + blockSize);
-
-            for (int i = ii; i < imax; i++) {
-                if (!symmetric) continue; // short-circuit
-                int jStart = (i == ii) ? (i + 1) : jj;
-                int limit = jmax - ((jmax - jStart) % 4);
-
-                for (int j = jStart; j < limit; j += 4) {
-                    if (matrix[i * n + j]       != matrix[j * n + i]       ||
-                        matrix[i * n + (j + 1)] != matrix[(j + 1) * n + i] ||
-                        matrix[i * n + (j + 2)] != matrix[(j + 2) * n + i] ||
-                        matrix[i * n + (j + 3)] != matrix[(j + 3) * n + i]) {
-                        symmetric = 0;
-                    }
-                }
-                // leftover elements
-                for (int j = limit; j < jmax; j++) {
-                    if (matrix[i * n + j] != matrix[j * n + i]) {
-                        symmetric = 0;
-                    }
-                }
-            }
+    int asymmetric = 0;
+    int nb = (n + blockSize - 1) / blockSize;
+    long tiles = (long)nb * (nb + 1) / 2;
+
+#pragma omp parallel for default(none) shared(matrix, n, blockSize, nb, tiles, asymmetric) schedule(dynamic)
+    for (long t = 0; t < tiles; t++) {
+        int found;
+#pragma omp atomic read
+        found = asymmetric;
+        if (found) continue;
+
+        int bi, bj;
+        triangleTile(t, nb, &bi, &bj);
+        int ii = bi * blockSize, jj = bj * blockSize;
+        int imax = (ii + blockSize > n) ? n : (ii + blockSize);
+        int jmax = (jj + blockSize > n) ? n : (jj + blockSize);
+
+        if (!blockIsSymmetric(matrix, n, ii, jj, imax, jmax)) {
+#pragma omp atomic write
+            asymmetric = 1;
         }
     }
-    return symmetric;
+    return !asymmetric;
 }
 
 /**
  * @brief Transposes an n x n matrix using a block-based approach with OpenMP.
  */
-void matTransposeOMP(float *matrix, float *transposed, int n)
+void matTransposeOMP(void *matrix, void *transposed, int n, int blockSize)
+{
+    matTransposeOMPRect(matrix, transposed, n, n, blockSize);
+}
+
+// Tile t of the flattened (ii, jj) loop of matTransposeOMPRect.
+static void transposeTileAt(const void *matrix, void *transposed, int rows, int cols,
+                            int blockSize, int tileCols, long t, int stream)
+{
+    int ii = (int)(t / tileCols) * blockSize;
+    int jj = (int)(t % tileCols) * blockSize;
+    int imax = (ii + blockSize > rows) ? rows : (ii + blockSize);
+    int jmax = (jj + blockSize > cols) ? cols : (jj + blockSize);
+
+    // register-tile kernel inside the cache block
+    if (stream) {
+        transposeTileStream(ELEM(matrix, (size_t)ii * cols + jj), cols,
+                            ELEM(transposed, (size_t)jj * rows + ii), rows,
+                            imax - ii, jmax - jj);
+    } else {
+        transposeTile(ELEM(matrix, (size_t)ii * cols + jj), cols,
+                      ELEM(transposed, (size_t)jj * rows + ii), rows,
+                      imax - ii, jmax - jj);
+    }
+}
+
+/**
+ * @brief Transposes a rows x cols matrix into the cols x rows 'transposed'.
+ *
+ * The (ii, jj) tiles are flattened into one loop with a dynamic schedule,
+ * so every thread gets work even when there are fewer tile rows than
+ * threads. With --numa the schedule is static instead, matching the pages
+ * firstTouchOMP placed (see numa_placement.h). Outputs larger than the
+ * last-level cache use streaming stores; every thread fences its own
+ * non-temporal stores before leaving the region.
+ */
+void matTransposeOMPRect(void *matrix, void *transposed, int rows, int cols, int blockSize)
 {
-    int blockSize = 64;
-
-#pragma omp parallel for default(none) shared(matrix, transposed, n, blockSize)
-    for (int ii = 0; ii < n; ii += blockSize) {
-        for (int jj = 0; jj < n; jj += blockSize) {
-            int imax = (ii + blockSize > n) ? n : (ii + blockSize);
-            int jmax = (jj + blockSize > n) ? n : (jj + blockSize);
-
-            for (int i = ii; i < imax; i++) {
-                int limit = jmax - ((jmax - jj) % 4);
-                for (int j = jj; j < limit; j += 4) {
-                    transposed[j * n + i]         = matrix[i * n + j];
-                    transposed[(j + 1) * n + i]   = matrix[i * n + (j + 1)];
-                    transposed[(j + 2) * n + i]   = matrix[i * n + (j + 2)];
-                    transposed[(j + 3) * n + i]   = matrix[i * n + (j + 3)];
-                }
-                // leftover columns
-                for (int j = limit; j < jmax; j++) {
-                    transposed[j * n + i] = matrix[i * n + j];
-                }
+    int stream = useStreamingStores((size_t)rows * cols * elementBytes());
+    int placed = numaPlacementEnabled();
+    int tileRows = (rows + blockSize - 1) / blockSize;
+    int tileCols = (cols + blockSize - 1) / blockSize;
+    long tiles = (long)tileRows * tileCols;
+
+#pragma omp parallel default(none) \
+        shared(matrix, transposed, rows, cols, blockSize, stream, placed, tileCols, tiles)
+    {
+        if (placed) {
+#pragma omp for schedule(static) nowait
+            for (long t = 0; t < tiles; t++) {
+                transposeTileAt(matrix, transposed, rows, cols, blockSize, tileCols, t, stream);
+            }
+        } else {
+#pragma omp for schedule(dynamic) nowait
+            for (long t = 0; t < tiles; t++) {
+                transposeTileAt(matrix, transposed, rows, cols, blockSize, tileCols, t, stream);
             }
         }
+        if (stream) {
+            streamFence();
+        }
+    }
+}
+
+/**
+ * In-place work for one strip of tile rows of an n x n square: transpose the
+ * diagonal tile and swap every tile to its right with its mirror below.
+ */
+static void inPlaceStrip(void *square, int n, int ii, int blockSize)
+{
+    int imax = (ii + blockSize > n) ? n : (ii + blockSize);
+
+    transposeBlockedInPlace(ELEM(square, (size_t)ii * n + ii), n, imax - ii, blockSize);
+
+    for (int jj = imax; jj < n; jj += blockSize) {
+        int jmax = (jj + blockSize > n) ? n : (jj + blockSize);
+        transposeSwapTiles(ELEM(square, (size_t)ii * n + jj), ELEM(square, (size_t)jj * n + ii), n,
+                           imax - ii, jmax - jj);
+    }
+}
+
+/**
+ * @brief Transposes an n x n matrix in place with OpenMP.
+ *
+ * Scheduled per tile pair of the upper triangle: a diagonal tile is
+ * transposed in place, any other tile is swapped with its mirror below the
+ * diagonal. Pairs are handed out dynamically because their cost varies.
+ */
+void matTransposeInPlaceOMP(void *matrix, int n, int blockSize)
+{
+    int nb = (n + blockSize - 1) / blockSize;
+    long tiles = (long)nb * (nb + 1) / 2;
+
+#pragma omp parallel for default(none) shared(matrix, n, blockSize, nb, tiles) schedule(dynamic)
+    for (long t = 0; t < tiles; t++) {
+        int bi, bj;
+        triangleTile(t, nb, &bi, &bj);
+        int ii = bi * blockSize, jj = bj * blockSize;
+        int imax = (ii + blockSize > n) ? n : (ii + blockSize);
+        int jmax = (jj + blockSize > n) ? n : (jj + blockSize);
+
+        if (bi == bj) {
+            transposeBlockedInPlace(ELEM(matrix, (size_t)ii * n + ii), n, imax - ii, blockSize);
+        } else {
+            transposeSwapTiles(ELEM(matrix, (size_t)ii * n + jj), ELEM(matrix, (size_t)jj * n + ii), n,
+                               imax - ii, jmax - jj);
+        }
+    }
+}
+
+/**
+ * Transposes q consecutive n x n squares in place; the (square, strip) pairs
+ * are flattened into one loop so q = 1 and large q both use every thread.
+ */
+static void inPlaceSquaresOMP(void *matrix, long q, int n, int blockSize)
+{
+    long strips = (n + blockSize - 1) / blockSize;
+
+#pragma omp parallel for default(none) shared(matrix, q, n, blockSize, strips) schedule(dynamic)
+    for (long t = 0; t < q * strips; t++) {
+        long k = t / strips;
+        int ii = (int)(t % strips) * blockSize;
+        inPlaceStrip(ELEM(matrix, k * n * n), n, ii, blockSize);
+    }
+}
+
+/**
+ * Parallel cycle-following over a P x Q grid of L-element segments.
+ * One serial pass finds the cycle leaders with the one-bit-per-segment
+ * visited map of transposeSegmentsInPlace, touching indices only; the
+ * threads then move whole cycles, one leader at a time. A single thread
+ * just runs transposeSegmentsInPlace.
+ */
+static void transposeSegmentsInPlaceOMP(void *a, long P, long Q, long L)
+{
+    long N = P * Q;
+    int threads = omp_get_max_threads();
+    if (P <= 1 || Q <= 1) {
+        return;
+    }
+    if (threads == 1) {
+        transposeSegmentsInPlace(a, P, Q, L);
+        return;
+    }
+    uint64_t mod = (uint64_t)(N - 1);
+    char *p = (char *)a;
+    size_t bytes = (size_t)L * elementBytes();
+
+    // carry + swap per thread, the visited map and the leader list, allocated
+    // up front so a failure can abort
+    long capacity = 1024, leaderCount = 0;
+    long *leaders = (long *)malloc(capacity * sizeof(long));
+    uint8_t *done = (uint8_t *)calloc((N + 7) / 8, 1);
+    char *buffers = (char *)malloc((size_t)threads * 2 * bytes);
+    if (!leaders || !done || !buffers) {
+        fprintf(stderr, "transposeSegmentsInPlaceOMP: Could not allocate the cycle buffers\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // ---- 1) cycle leaders: segment k moves to k*P mod (N-1); 0 and N-1 stay put
+    for (long s = 1; s < N - 1; s++) {
+        if (done[s >> 3] & (1u << (s & 7))) {
+            continue;
+        }
+        if (leaderCount == capacity) {
+            capacity *= 2;
+            leaders = (long *)realloc(leaders, capacity * sizeof(long));
+            if (!leaders) {
+                fprintf(stderr, "transposeSegmentsInPlaceOMP: Could not allocate %ld leaders\n",
+                        capacity);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+        leaders[leaderCount++] = s;
+        long k = s;
+        do {
+            done[k >> 3] |= (uint8_t)(1u << (k & 7));
+            k = (long)(((uint64_t)k * (uint64_t)P) % mod);
+        } while (k != s);
+    }
+    free(done);
+
+    // ---- 2) every cycle moved by one thread
+#pragma omp parallel num_threads(threads) default(none) \
+        shared(p, P, bytes, mod, buffers, leaders, leaderCount)
+    {
+        char *carry = buffers + (size_t)omp_get_thread_num() * 2 * bytes;
+        char *swap  = carry + bytes;
+
+#pragma omp for schedule(dynamic, 16)
+        for (long c = 0; c < leaderCount; c++) {
+            long s = leaders[c], k = s;
+            memcpy(carry, &p[s * bytes], bytes);
+            do {
+                long d = (long)(((uint64_t)k * (uint64_t)P) % mod);
+                memcpy(swap, &p[d * bytes], bytes);
+                memcpy(&p[d * bytes], carry, bytes);
+                memcpy(carry, swap, bytes);
+                k = d;
+            } while (k != s);
+        }
+    }
+    free(buffers);
+    free(leaders);
+}
+
+/**
+ * @brief In-place rows x cols transpose with OpenMP (see matTransposeInPlaceRect).
+ */
+void matTransposeInPlaceRectOMP(void *matrix, int rows, int cols, int blockSize)
+{
+    if (rows == cols) {
+        matTransposeInPlaceOMP(matrix, rows, blockSize);
+    }
+    else if (rows % cols == 0) {
+        inPlaceSquaresOMP(matrix, rows / cols, cols, blockSize);
+        transposeSegmentsInPlaceOMP(matrix, rows / cols, cols, cols);
+    }
+    else if (cols % rows == 0) {
+        transposeSegmentsInPlaceOMP(matrix, rows, cols / rows, rows);
+        inPlaceSquaresOMP(matrix, cols / rows, rows, blockSize);
+    }
+    else {
+        transposeSegmentsInPlaceOMP(matrix, rows, cols, 1);
     }
 }
@@ -0,0 +1,143 @@
+#define _DEFAULT_SOURCE  // madvise, ftruncate
+#include <stddef.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "matrix_operations.h"
+#include "simd_kernels.h"
+
+/*
+ Byte range [offset, offset + len) of a mapping widened to whole pages,
+ as madvise wants. Widening is harmless here: both mappings are
+ MAP_SHARED file mappings, so MADV_DONTNEED only drops our page-table
+ entries and dirty pages stay in the page cache until written back.
+ */
+static void adviseRange(char *base, size_t mapBytes, size_t offset, size_t len, int advice)
+{
+    size_t page  = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = offset / page * page;
+    size_t end   = offset + len;
+    if (end > mapBytes) end = mapBytes;
+    if (end > start) {
+        madvise(base + start, end - start, advice);
+    }
+}
+
+// Applies 'advice' to the h x w tile at (i0, j0) of a row-major matrix
+// with ld columns: one range per row.
+static void adviseTile(void *base, size_t mapBytes, int ld, long i0, long j0,
+                       long h, long w, int advice)
+{
+    size_t es = elementBytes();
+    for (long i = i0; i < i0 + h; i++) {
+        adviseRange((char *)base, mapBytes, ((size_t)i * ld + j0) * es, (size_t)w * es, advice);
+    }
+}
+
+/*
+ Tile edge for a memory budget. Per step we hold the current input tile,
+ the prefetched next one and the output tile; each is B rows of B elements
+ plus up to one partial page per row. Multiples of a page of elements keep
+ the rows of a tile page-aligned whenever the matrix rows are.
+ */
+static long tileForBudget(size_t budgetBytes)
+{
+    size_t es = elementBytes();
+    long pageElems = sysconf(_SC_PAGESIZE) / (long)es;
+    long b = 16;
+    while (3 * (size_t)(2 * b) * ((2 * b + pageElems) * es) <= budgetBytes) {
+        b *= 2;
+    }
+    if (b >= pageElems) b = b / pageElems * pageElems;
+    return b;
+}
+
+// Maps 'bytes' of payload starting at 'offset' (page-aligned).
+static char *mapFile(const char *path, int writable, off_t offset, size_t bytes, int *fd)
+{
+    *fd = open(path, writable ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDONLY, 0644);
+    if (*fd < 0) {
+        fprintf(stderr, "Out-of-core: cannot open '%s'\n", path);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (writable) {
+        if (ftruncate(*fd, (off_t)bytes) != 0) {
+            fprintf(stderr, "Out-of-core: cannot size '%s' to %zu bytes\n", path, bytes);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    } else {
+        struct stat st;
+        if (fstat(*fd, &st) != 0 || (size_t)(st.st_size - offset) != bytes) {
+            fprintf(stderr, "Out-of-core: '%s' does not hold %zu bytes\n", path, bytes);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    void *map = mmap(NULL, bytes, writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                     MAP_SHARED, *fd, offset);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Out-of-core: cannot map '%s'\n", path);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return (char *)map;
+}
+
+/**
+ * Out-of-core transpose of a rows x cols row-major file into a raw cols x rows
+ * one, for matrices larger than memory. Both files are mmap'ed and walked
+ * in B x B tiles sized so that about budgetBytes stay resident: while one
+ * tile is transposed (blockSize cache blocks on the OpenMP threads) the
+ * next input tile is prefetched with MADV_WILLNEED, and finished tiles are
+ * released with MADV_DONTNEED. Tiles run along row bands of M, which
+ * MADV_SEQUENTIAL lets the kernel read ahead. All offsets are 64-bit.
+ * The payload of the input starts at inOffset, which must be page-aligned
+ * (0 for raw files, the 4 KiB-aligned dataOffset of a row-major binary
+ * matrix file).
+ */
+void matTransposeOutOfCore(const char *inPath, long inOffset, const char *outPath,
+                           int rows, int cols, size_t budgetBytes, int blockSize)
+{
+    size_t es = elementBytes();
+    size_t bytes = (size_t)rows * cols * es;
+    if (bytes == 0) return;
+
+    int inFd, outFd;
+    char *in  = mapFile(inPath, 0, (off_t)inOffset, bytes, &inFd);
+    char *out = mapFile(outPath, 1, 0, bytes, &outFd);
+    madvise(in, bytes, MADV_SEQUENTIAL);
+
+    long b = tileForBudget(budgetBytes);
+    long tilesI = (rows + b - 1) / b;
+    long tilesJ = (cols + b - 1) / b;
+    long nTiles = tilesI * tilesJ;
+
+    for (long t = 0; t < nTiles; t++) {
+        long i0 = (t / tilesJ) * b, j0 = (t % tilesJ) * b;
+        long h = (rows - i0 < b) ? rows - i0 : b;
+        long w = (cols - j0 < b) ? cols - j0 : b;
+
+        // ---- 1) start reading the next tile while this one is transposed
+        if (t + 1 < nTiles) {
+            long ni = ((t + 1) / tilesJ) * b, nj = ((t + 1) % tilesJ) * b;
+            adviseTile(in, bytes, cols, ni, nj, (rows - ni < b) ? rows - ni : b,
+                       (cols - nj < b) ? cols - nj : b, MADV_WILLNEED);
+        }
+
+        // ---- 2) T[j0.., i0..] = M[i0.., j0..]^T with the blocked kernels
+        transposeBlockedThreads(&in[((size_t)i0 * cols + j0) * es], cols,
+                                &out[((size_t)j0 * rows + i0) * es], rows, (int)h, (int)w, blockSize);
+
+        // ---- 3) release both tiles; dirty output pages are written back
+        //         by the page cache
+        adviseTile(in, bytes, cols, i0, j0, h, w, MADV_DONTNEED);
+        adviseTile(out, bytes, rows, j0, i0, w, h, MADV_DONTNEED);
+    }
+
+    msync(out, bytes, MS_SYNC);
+    munmap(in, bytes);
+    munmap(out, bytes);
+    close(inFd);
+    close(outFd);
+}
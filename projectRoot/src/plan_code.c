@@ -0,0 +1,321 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "transpose_plan.h"
+#include "matrix_operations.h"
+#include "mpi_common.h"
+#include "simd_kernels.h"
+#include "matrix_alloc.h"
+
+enum { PLAN_SERIALBLOCK, PLAN_OMP, PLAN_MPI4 };
+enum { TAG_SCATTER, TAG_EXCHANGE, TAG_GATHER };
+
+struct TransposePlan {
+    int method;
+    int rows, cols, blockSize;
+    ElemType elemType;           // element type and size at create time
+    size_t es;
+    void *matrix, *transposed;   // rank 0's arrays
+
+    // ---- mpi4 only
+    MPI_Comm comm;
+    int rank, size;
+    int localRows, localCols;    // rows of M / rows of T on this rank
+    int rowStart, colStart;
+    int *rowSlab, *colSlab;      // size + 1 slab bounds
+    size_t *sendOff, *recvOff;   // per-peer block offsets (elements)
+    void *pool;                  // localM, localT, sendBuf, recvBuf
+    void *localM, *localT, *sendBuf, *recvBuf;
+    MPI_Datatype rowM, rowT;     // one row of M / of T
+    MPI_Request *scatterReq;     // rank 0: size - 1 sends, else 1 receive
+    MPI_Request *gatherReq;      // rank 0: size - 1 receives, else 1 send
+    MPI_Request *recvReq, *sendReq;  // exchange, staggered like matTransposeMPI4Dist
+    int *recvFrom;
+    int nScatter;
+};
+
+TransposePlan *transposePlanCreate(void *matrix, void *transposed, int n,
+                                   const char *method, int blockSize, MPI_Comm comm)
+{
+    return transposePlanCreateRect(matrix, transposed, n, n, method, blockSize, comm);
+}
+
+// Rounds 'bytes' up so the next buffer carved from the pool stays aligned.
+static size_t alignedBytes(size_t bytes)
+{
+    return (bytes + MATRIX_ALIGN - 1) / MATRIX_ALIGN * MATRIX_ALIGN;
+}
+
+/*
+ mpi4 set-up: everything matTransposeMPI4Dist derives per call. Rank 0
+ works on 'matrix' and 'transposed' in place of localM / localT (its slabs
+ are their first rows), so it never copies its own part; the other ranks
+ receive their slab of M into localM and send their slab of T from localT.
+ */
+static void createMPI4(TransposePlan *plan)
+{
+    int rank = plan->rank, size = plan->size;
+    int rows = plan->rows, cols = plan->cols;
+    size_t es = plan->es;
+
+    plan->rowSlab = (int *)malloc((size + 1) * sizeof(int));
+    plan->colSlab = (int *)malloc((size + 1) * sizeof(int));
+    plan->sendOff = (size_t *)malloc((size + 1) * sizeof(size_t));
+    plan->recvOff = (size_t *)malloc((size + 1) * sizeof(size_t));
+    for (int k = 0; k <= size; k++) {
+        plan->rowSlab[k] = slabStartOf(rows, k, size);
+        plan->colSlab[k] = slabStartOf(cols, k, size);
+    }
+    plan->rowStart  = plan->rowSlab[rank];
+    plan->colStart  = plan->colSlab[rank];
+    plan->localRows = plan->rowSlab[rank + 1] - plan->rowStart;
+    plan->localCols = plan->colSlab[rank + 1] - plan->colStart;
+
+    plan->sendOff[0] = plan->recvOff[0] = 0;
+    for (int k = 0; k < size; k++) {
+        int kRows = plan->rowSlab[k + 1] - plan->rowSlab[k];
+        int kCols = plan->colSlab[k + 1] - plan->colSlab[k];
+        plan->sendOff[k + 1] = plan->sendOff[k] + (k == rank ? 0 : (size_t)plan->localRows * kCols);
+        plan->recvOff[k + 1] = plan->recvOff[k] + (k == rank ? 0 : (size_t)kRows * plan->localCols);
+    }
+
+    // ---- 1) one aligned pool for every buffer
+    size_t slabBytes = (rank == 0) ? 0 : alignedBytes((size_t)plan->localRows * cols * es);
+    size_t tBytes    = (rank == 0) ? 0 : alignedBytes((size_t)plan->localCols * rows * es);
+    size_t sendBytes = alignedBytes((plan->sendOff[size] + 1) * es);
+    size_t recvBytes = alignedBytes((plan->recvOff[size] + 1) * es);
+    plan->pool = matrixAlloc(slabBytes + tBytes + sendBytes + recvBytes, "plan pool");
+    if (!plan->pool) {
+        fprintf(stderr, "Rank %d: Could not allocate the plan buffers\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    char *p = (char *)plan->pool;
+    plan->localM  = (rank == 0) ? plan->matrix : p;
+    plan->localT  = (rank == 0) ? plan->transposed : p + slabBytes;
+    plan->sendBuf = p + slabBytes + tBytes;
+    plan->recvBuf = p + slabBytes + tBytes + sendBytes;
+
+    // ---- 2) row datatypes (slab counts stay small even for huge matrices)
+    MPI_Type_contiguous(cols, elementMPIType(), &plan->rowM);
+    MPI_Type_contiguous(rows, elementMPIType(), &plan->rowT);
+    MPI_Type_commit(&plan->rowM);
+    MPI_Type_commit(&plan->rowT);
+
+    // ---- 3) persistent requests: scatter, exchange, gather
+    plan->nScatter   = (rank == 0) ? size - 1 : 1;
+    plan->scatterReq = (MPI_Request *)malloc(plan->nScatter * sizeof(MPI_Request));
+    plan->gatherReq  = (MPI_Request *)malloc(plan->nScatter * sizeof(MPI_Request));
+    if (rank == 0) {
+        for (int k = 1; k < size; k++) {
+            int kRows = plan->rowSlab[k + 1] - plan->rowSlab[k];
+            int kCols = plan->colSlab[k + 1] - plan->colSlab[k];
+            MPI_Send_init(ELEM(plan->matrix, (size_t)plan->rowSlab[k] * cols), kRows,
+                          plan->rowM, k, TAG_SCATTER, plan->comm, &plan->scatterReq[k - 1]);
+            MPI_Recv_init(ELEM(plan->transposed, (size_t)plan->colSlab[k] * rows), kCols,
+                          plan->rowT, k, TAG_GATHER, plan->comm, &plan->gatherReq[k - 1]);
+        }
+    } else {
+        MPI_Recv_init(plan->localM, plan->localRows, plan->rowM, 0, TAG_SCATTER, plan->comm,
+                      &plan->scatterReq[0]);
+        MPI_Send_init(plan->localT, plan->localCols, plan->rowT, 0, TAG_GATHER, plan->comm,
+                      &plan->gatherReq[0]);
+    }
+
+    plan->recvReq  = (MPI_Request *)malloc(size * sizeof(MPI_Request));
+    plan->sendReq  = (MPI_Request *)malloc(size * sizeof(MPI_Request));
+    plan->recvFrom = (int *)malloc(size * sizeof(int));
+    for (int k = 1; k < size; k++) {
+        int src = (rank - k + size) % size;
+        int dst = (rank + k) % size;
+        plan->recvFrom[k - 1] = src;
+        MPI_Recv_init(ELEM(plan->recvBuf, plan->recvOff[src]),
+                      (int)(plan->recvOff[src + 1] - plan->recvOff[src]), elementMPIType(),
+                      src, TAG_EXCHANGE, plan->comm, &plan->recvReq[k - 1]);
+        MPI_Send_init(ELEM(plan->sendBuf, plan->sendOff[dst]),
+                      (int)(plan->sendOff[dst + 1] - plan->sendOff[dst]), elementMPIType(),
+                      dst, TAG_EXCHANGE, plan->comm, &plan->sendReq[k - 1]);
+    }
+}
+
+TransposePlan *transposePlanCreateRect(void *matrix, void *transposed, int rows, int cols,
+                                       const char *method, int blockSize, MPI_Comm comm)
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    int kind;
+    if      (strcmp(method, "serialblock") == 0) kind = PLAN_SERIALBLOCK;
+    else if (strcmp(method, "omp") == 0)         kind = PLAN_OMP;
+    else if (strcmp(method, "mpi4") == 0)        kind = PLAN_MPI4;
+    else {
+        if (rank == 0) {
+            fprintf(stderr, "No transpose plan for method '%s' (use serialblock, omp or mpi4).\n",
+                    method);
+        }
+        return NULL;
+    }
+    if (rank == 0 && (matrix == NULL || transposed == NULL)) {
+        fprintf(stderr, "transposePlanCreate: rank 0 needs both matrices\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    TransposePlan *plan = (TransposePlan *)calloc(1, sizeof(TransposePlan));
+    plan->method     = kind;
+    plan->rows       = rows;
+    plan->cols       = cols;
+    plan->blockSize  = blockSize;
+    plan->elemType   = elementType();
+    plan->es         = elementBytes();
+    plan->matrix     = matrix;
+    plan->transposed = transposed;
+    plan->rank       = rank;
+    MPI_Comm_size(comm, &plan->size);
+
+    if (kind == PLAN_MPI4) {
+        // own communicator: the plan's messages never match anybody else's
+        MPI_Comm_dup(comm, &plan->comm);
+        createMPI4(plan);
+    }
+    return plan;
+}
+
+/*
+ matTransposeMPI4Dist plus the scatter and gather, on the plan's buffers:
+ all receives of the exchange are started before the scatter completes,
+ so blocks from fast peers land right away; packing, the diagonal block
+ and the unpack tasks run on the rank's threads exactly as in mpi4.
+ */
+static void executeMPI4(TransposePlan *plan)
+{
+    int rank = plan->rank, size = plan->size;
+    int rows = plan->rows, cols = plan->cols;
+    int localRows = plan->localRows, localCols = plan->localCols;
+    int rowStart = plan->rowStart, colStart = plan->colStart;
+    int *rowSlab = plan->rowSlab, *colSlab = plan->colSlab;
+    size_t *sendOff = plan->sendOff, *recvOff = plan->recvOff;
+    MPI_Request *recvReq = plan->recvReq, *sendReq = plan->sendReq;
+    int *recvFrom = plan->recvFrom;
+    // byte addressing with the plan's element size, not the global ELEM()
+    char *M = (char *)plan->localM, *T = (char *)plan->localT;
+    char *sendBytes = (char *)plan->sendBuf, *recvBytes = (char *)plan->recvBuf;
+    size_t es = plan->es;
+
+    // ---- 1) exchange receives, then the scatter of M
+    if (size > 1) {
+        MPI_Startall(size - 1, recvReq);
+        MPI_Startall(plan->nScatter, plan->scatterReq);
+        if (rank != 0) {
+            MPI_Wait(&plan->scatterReq[0], MPI_STATUS_IGNORE);
+        }
+    }
+
+    // ---- 2) pack, send, diagonal block and unpack, as in matTransposeMPI4Dist
+#pragma omp parallel shared(M, T, sendBytes, recvBytes, sendOff, recvOff, rowSlab, colSlab, \
+                            recvReq, sendReq, recvFrom, rank, size, rows, cols, rowStart, \
+                            colStart, localRows, localCols, es)
+    {
+#pragma omp for collapse(2) schedule(static)
+        for (int k = 1; k < size; k++) {
+            for (int r = 0; r < localRows; r++) {
+                int dst = (rank + k) % size;
+                int dstStart = colSlab[dst];
+                int dstCols = colSlab[dst + 1] - dstStart;
+                memcpy(sendBytes + (sendOff[dst] + (size_t)r * dstCols) * es,
+                       M + ((size_t)r * cols + dstStart) * es, dstCols * es);
+            }
+        }
+
+#pragma omp master
+        {
+            if (size > 1) {
+                MPI_Startall(size - 1, sendReq);
+            }
+
+#pragma omp task
+            transposeBlocked(M + (size_t)colStart * es, cols, T + (size_t)rowStart * es, rows,
+                             localRows, localCols, 64);
+
+            for (int done = 0; done < size - 1; done++) {
+                int idx;
+                MPI_Waitany(size - 1, recvReq, &idx, MPI_STATUS_IGNORE);
+                int k = recvFrom[idx];
+                int kRowStart = rowSlab[k];
+                int kRows = rowSlab[k + 1] - kRowStart;
+#pragma omp task firstprivate(k, kRowStart, kRows)
+                transposeBlocked(recvBytes + recvOff[k] * es, localCols,
+                                 T + (size_t)kRowStart * es, rows, kRows, localCols, 64);
+            }
+            if (size > 1) {
+                MPI_Waitall(size - 1, sendReq, MPI_STATUSES_IGNORE);
+            }
+        }
+    }   // the closing barrier also waits for the unpack tasks
+
+    // ---- 3) gather the slabs of T straight into rank 0's 'transposed'
+    if (size > 1) {
+        MPI_Startall(plan->nScatter, plan->gatherReq);
+        MPI_Waitall(plan->nScatter, plan->gatherReq, MPI_STATUSES_IGNORE);
+        if (rank == 0) {
+            MPI_Waitall(plan->nScatter, plan->scatterReq, MPI_STATUSES_IGNORE);
+        }
+    }
+}
+
+void transposePlanExecute(TransposePlan *plan)
+{
+    // the kernels follow the global element type: run with the plan's
+    ElemType current = elementType();
+    if (current != plan->elemType) setElementType(elementTypeName(plan->elemType));
+
+    switch (plan->method) {
+    case PLAN_SERIALBLOCK:
+        if (plan->rank == 0) {
+            matTransposeBlockRect(plan->matrix, plan->transposed, plan->rows, plan->cols,
+                                  plan->blockSize);
+        }
+        break;
+    case PLAN_OMP:
+        if (plan->rank == 0) {
+            matTransposeOMPRect(plan->matrix, plan->transposed, plan->rows, plan->cols,
+                                plan->blockSize);
+        }
+        break;
+    case PLAN_MPI4:
+        executeMPI4(plan);
+        break;
+    }
+
+    if (current != plan->elemType) setElementType(elementTypeName(current));
+}
+
+void transposePlanDestroy(TransposePlan *plan)
+{
+    if (!plan) return;
+
+    if (plan->method == PLAN_MPI4) {
+        for (int k = 0; k < plan->nScatter; k++) {
+            MPI_Request_free(&plan->scatterReq[k]);
+            MPI_Request_free(&plan->gatherReq[k]);
+        }
+        for (int k = 0; k < plan->size - 1; k++) {
+            MPI_Request_free(&plan->recvReq[k]);
+            MPI_Request_free(&plan->sendReq[k]);
+        }
+        MPI_Type_free(&plan->rowM);
+        MPI_Type_free(&plan->rowT);
+        MPI_Comm_free(&plan->comm);
+
+        free(plan->scatterReq);
+        free(plan->gatherReq);
+        free(plan->recvReq);
+        free(plan->sendReq);
+        free(plan->recvFrom);
+        free(plan->rowSlab);
+        free(plan->colSlab);
+        free(plan->sendOff);
+        free(plan->recvOff);
+        matrixFree(plan->pool);
+    }
+    free(plan);
+}
@@ -0,0 +1,88 @@
+#include <stddef.h>
+#include <omp.h>
+#include "matrix_operations.h"
+#include "simd_kernels.h"
+
+// Stop splitting once a tile is at most RECURSIVE_BASE x RECURSIVE_BASE;
+// split points are kept on multiples of 16 so every register kernel
+// (4x4, 8x8, 16x16) sees full tiles away from the matrix edges.
+#define RECURSIVE_BASE 32
+// Below this many elements the OpenMP variant stops spawning tasks.
+#define RECURSIVE_TASK_CUTOFF (256 * 256)
+
+static int splitPoint(int len)
+{
+    int half = (len / 2 + 15) & ~15;
+    return (half > 0 && half < len) ? half : len / 2;
+}
+
+/**
+ * Cache-oblivious divide and conquer: halve the longer side until the tile
+ * fits the base case, so every level of the cache hierarchy eventually
+ * holds a whole sub-problem without knowing its size.
+ */
+static void recursiveTranspose(const void *src, int lds, void *dst, int ldd,
+                               int rows, int cols)
+{
+    if (rows <= RECURSIVE_BASE && cols <= RECURSIVE_BASE) {
+        transposeTile(src, lds, dst, ldd, rows, cols);
+    }
+    else if (rows >= cols) {
+        int h = splitPoint(rows);
+        recursiveTranspose(src, lds, dst, ldd, h, cols);
+        recursiveTranspose(ELEM(src, (size_t)h * lds), lds, ELEM(dst, h), ldd, rows - h, cols);
+    }
+    else {
+        int h = splitPoint(cols);
+        recursiveTranspose(src, lds, dst, ldd, rows, h);
+        recursiveTranspose(ELEM(src, h), lds, ELEM(dst, (size_t)h * ldd), ldd, rows, cols - h);
+    }
+}
+
+static void recursiveTransposeTasks(const void *src, int lds, void *dst, int ldd,
+                                    int rows, int cols)
+{
+    if ((long)rows * cols <= RECURSIVE_TASK_CUTOFF) {
+        recursiveTranspose(src, lds, dst, ldd, rows, cols);
+    }
+    else if (rows >= cols) {
+        int h = splitPoint(rows);
+#pragma omp task default(none) firstprivate(src, lds, dst, ldd, h, cols)
+        recursiveTransposeTasks(src, lds, dst, ldd, h, cols);
+        recursiveTransposeTasks(ELEM(src, (size_t)h * lds), lds, ELEM(dst, h), ldd, rows - h, cols);
+    }
+    else {
+        int h = splitPoint(cols);
+#pragma omp task default(none) firstprivate(src, lds, dst, ldd, h, rows)
+        recursiveTransposeTasks(src, lds, dst, ldd, rows, h);
+        recursiveTransposeTasks(ELEM(src, h), lds, ELEM(dst, (size_t)h * ldd), ldd, rows, cols - h);
+    }
+}
+
+void matTransposeRecursive(void *matrix, void *transposed, int n)
+{
+    matTransposeRecursiveRect(matrix, transposed, n, n);
+}
+
+void matTransposeRecursiveRect(void *matrix, void *transposed, int rows, int cols)
+{
+    recursiveTranspose(matrix, cols, transposed, rows, rows, cols);
+}
+
+/**
+ * @brief Recursive transpose where the upper levels of the recursion become
+ *        OpenMP tasks; the halves write disjoint parts of 'transposed'.
+ */
+void matTransposeRecursiveOMP(void *matrix, void *transposed, int n)
+{
+    matTransposeRecursiveOMPRect(matrix, transposed, n, n);
+}
+
+void matTransposeRecursiveOMPRect(void *matrix, void *transposed, int rows, int cols)
+{
+#pragma omp parallel default(none) shared(matrix, transposed, rows, cols)
+    {
+#pragma omp single
+        recursiveTransposeTasks(matrix, cols, transposed, rows, rows, cols);
+    }
+}
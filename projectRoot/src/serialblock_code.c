@@ -1,6 +1,8 @@
+#include <stddef.h>
 #include "matrix_operations.h"
+#include "simd_kernels.h"
 
-int checkSymBlock(float *matrix, int n, int blockSize)
+int checkSymBlock(void *matrix, int n, int blockSize)
 {
     for (int ii = 0; ii < n; ii += blockSize) {
         for (int jj = ii; jj < n; jj += blockSize) {
@@ -10,10 +12,8 @@ int checkSymBlock(float *matrix, int n, int blockSize)
             for (int i = ii; i < imax; i++) {
                 // Only need to compare part above diagonal
                 int jStart = (i == ii) ? i + 1 : jj;
-                for (int j = jStart; j < jmax; j++) {
-                    if (matrix[i * n + j] != matrix[j * n + i]) {
-                        return 0;
-                    }
+                if (!mirrorEqual(matrix, n, i, jStart, jmax)) {
+                    return 0;
                 }
             }
         }
@@ -21,18 +21,83 @@ int checkSymBlock(float *matrix, int n, int blockSize)
     return 1;
 }
 
-void matTransposeBlock(float *matrix, float *transposed, int n, int blockSize)
+void matTransposeBlock(void *matrix, void *transposed, int n, int blockSize)
 {
-    for (int ii = 0; ii < n; ii += blockSize) {
-        for (int jj = 0; jj < n; jj += blockSize) {
-            int imax = (ii + blockSize > n) ? n : (ii + blockSize);
-            int jmax = (jj + blockSize > n) ? n : (jj + blockSize);
+    matTransposeBlockRect(matrix, transposed, n, n, blockSize);
+}
 
-            for (int i = ii; i < imax; i++) {
-                for (int j = jj; j < jmax; j++) {
-                    transposed[j * n + i] = matrix[i * n + j];
-                }
+/**
+ * Outputs larger than the last-level cache are written with streaming
+ * stores (see transposeTileStream), so the destination is never read.
+ */
+void matTransposeBlockRect(void *matrix, void *transposed, int rows, int cols, int blockSize)
+{
+    int stream = useStreamingStores((size_t)rows * cols * elementBytes());
+
+    for (int ii = 0; ii < rows; ii += blockSize) {
+        for (int jj = 0; jj < cols; jj += blockSize) {
+            int imax = (ii + blockSize > rows) ? rows : (ii + blockSize);
+            int jmax = (jj + blockSize > cols) ? cols : (jj + blockSize);
+
+            // register-tile kernel inside the cache block
+            if (stream) {
+                transposeTileStream(ELEM(matrix, (size_t)ii * cols + jj), cols,
+                                    ELEM(transposed, (size_t)jj * rows + ii), rows,
+                                    imax - ii, jmax - jj);
+            } else {
+                transposeTile(ELEM(matrix, (size_t)ii * cols + jj), cols,
+                              ELEM(transposed, (size_t)jj * rows + ii), rows,
+                              imax - ii, jmax - jj);
             }
         }
     }
+    if (stream) {
+        streamFence();
+    }
+}
+
+/**
+ * In-place variant: diagonal tiles are transposed in place and each
+ * (ii,jj) tile above the diagonal is swapped with its (jj,ii) mirror,
+ * so no second n x n buffer is needed.
+ */
+void matTransposeInPlace(void *matrix, int n, int blockSize)
+{
+    transposeBlockedInPlace(matrix, n, n, blockSize);
+}
+
+/**
+ * In-place rows x cols transpose (cycle-following).
+ *
+ * If one dimension is a multiple of the other the matrix is a stack (or a
+ * row) of q squares: the squares are transposed with the blocked in-place
+ * kernel and the remaining permutation moves whole square rows, so the cycle
+ * walk touches contiguous segments instead of single elements. Otherwise it
+ * falls back to element-wise cycle-following.
+ */
+void matTransposeInPlaceRect(void *matrix, int rows, int cols, int blockSize)
+{
+    if (rows == cols) {
+        transposeBlockedInPlace(matrix, cols, cols, blockSize);
+    }
+    else if (rows % cols == 0) {
+        // tall: q stacked cols x cols squares -> transpose each, then
+        // move the q x cols grid of square rows to cols x q
+        long q = rows / cols;
+        for (long k = 0; k < q; k++) {
+            transposeBlockedInPlace(ELEM(matrix, k * cols * cols), cols, cols, blockSize);
+        }
+        transposeSegmentsInPlace(matrix, q, cols, cols);
+    }
+    else if (cols % rows == 0) {
+        // wide: gather each rows x rows square contiguously, then transpose it
+        long q = cols / rows;
+        transposeSegmentsInPlace(matrix, rows, q, rows);
+        for (long k = 0; k < q; k++) {
+            transposeBlockedInPlace(ELEM(matrix, k * rows * rows), rows, rows, blockSize);
+        }
+    }
+    else {
+        transposeSegmentsInPlace(matrix, rows, cols, 1);
+    }
 }
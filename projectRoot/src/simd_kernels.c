@@ -0,0 +1,843 @@
+#define _GNU_SOURCE  // _SC_LEVEL3_CACHE_SIZE
+#include <mpi.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "simd_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+// Tiles move raw element bits; lds/ldd are in elements of the kernel's width.
+typedef void (*TileKernel)(const void *src, int lds, void *dst, int ldd);
+
+/*****************************************************************************
+ * Element type
+ *****************************************************************************/
+
+static const struct {
+    const char *name;
+    size_t      bytes;
+} elemTypes[ELEM_TYPE_COUNT] = {
+    [ELEM_FLOAT]  = { "float",  4 },
+    [ELEM_DOUBLE] = { "double", 8 },
+    [ELEM_I8]     = { "i8",     1 },
+    [ELEM_I16]    = { "i16",    2 },
+    [ELEM_I32]    = { "i32",    4 },
+    [ELEM_C64]    = { "c64",    8 },
+};
+
+static ElemType elemType  = ELEM_FLOAT;
+static size_t   elemBytes = 4;
+
+// One element; the constant-size memcpys compile to single moves.
+static inline void copyElement(char *dst, const char *src, size_t es)
+{
+    switch (es) {
+    case 1:  memcpy(dst, src, 1); break;
+    case 2:  memcpy(dst, src, 2); break;
+    case 4:  memcpy(dst, src, 4); break;
+    default: memcpy(dst, src, 8); break;
+    }
+}
+
+static inline void swapElements(char *a, char *b, size_t es)
+{
+    char t[8];
+    copyElement(t, a, es);
+    copyElement(a, b, es);
+    copyElement(b, t, es);
+}
+
+/*****************************************************************************
+ * Scalar fallback (used before initTransposeKernels and on non-x86 builds)
+ *****************************************************************************/
+
+// One 4x4 kernel per element width; floats and i32 share the 32-bit one.
+#define SCALAR_TILE(name, type)                                   \
+    static void name(const void *src, int lds, void *dst, int ldd) \
+    {                                                              \
+        const type *s = (const type *)src;                         \
+        type *d = (type *)dst;                                     \
+        for (int r = 0; r < 4; r++) {                              \
+            for (int c = 0; c < 4; c++) {                          \
+                d[c * ldd + r] = s[r * lds + c];                   \
+            }                                                      \
+        }                                                          \
+    }
+
+SCALAR_TILE(tileScalar4x4x8,  uint8_t)
+SCALAR_TILE(tileScalar4x4x16, uint16_t)
+SCALAR_TILE(tileScalar4x4,    uint32_t)
+SCALAR_TILE(tileScalar4x4x64, uint64_t)
+
+typedef int (*EqualKernel)(const float *a, const float *b, int n);
+
+// != on floats, so a NaN never compares equal (same as the scalar checks)
+static int equalScalar(const float *a, const float *b, int n)
+{
+    for (int k = 0; k < n; k++) {
+        if (a[k] != b[k]) return 0;
+    }
+    return 1;
+}
+
+#ifdef HAVE_X86_KERNELS
+
+/*****************************************************************************
+ * SSE: 4x4 float tile, 2x2 double tile
+ *****************************************************************************/
+
+__attribute__((target("sse")))
+static void tileSSE4x4(const void *s, int lds, void *d, int ldd)
+{
+    const float *src = (const float *)s;
+    float *dst = (float *)d;
+
+    __m128 r0 = _mm_loadu_ps(&src[0 * lds]);
+    __m128 r1 = _mm_loadu_ps(&src[1 * lds]);
+    __m128 r2 = _mm_loadu_ps(&src[2 * lds]);
+    __m128 r3 = _mm_loadu_ps(&src[3 * lds]);
+
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    _mm_storeu_ps(&dst[0 * ldd], r0);
+    _mm_storeu_ps(&dst[1 * ldd], r1);
+    _mm_storeu_ps(&dst[2 * ldd], r2);
+    _mm_storeu_ps(&dst[3 * ldd], r3);
+}
+
+__attribute__((target("sse2")))
+static void tileSSE2x2d(const void *s, int lds, void *d, int ldd)
+{
+    const double *src = (const double *)s;
+    double *dst = (double *)d;
+
+    __m128d r0 = _mm_loadu_pd(&src[0 * lds]);
+    __m128d r1 = _mm_loadu_pd(&src[1 * lds]);
+
+    _mm_storeu_pd(&dst[0 * ldd], _mm_unpacklo_pd(r0, r1));
+    _mm_storeu_pd(&dst[1 * ldd], _mm_unpackhi_pd(r0, r1));
+}
+
+/*****************************************************************************
+ * SSE2: 16x16 byte and 8x8 16-bit tiles
+ *
+ * log2(w) rounds of interleaving row k with row k + w/2 (a perfect shuffle
+ * of the rows) transpose a w x w tile held in w 128-bit registers.
+ *****************************************************************************/
+
+__attribute__((target("sse2")))
+static void tileSSE16x16b(const void *s, int lds, void *d, int ldd)
+{
+    const uint8_t *src = (const uint8_t *)s;
+    uint8_t *dst = (uint8_t *)d;
+    __m128i x[16], y[16];
+
+    for (int k = 0; k < 16; k++) {
+        x[k] = _mm_loadu_si128((const __m128i *)&src[k * lds]);
+    }
+    for (int round = 0; round < 4; round++) {
+        for (int k = 0; k < 8; k++) {
+            y[2 * k]     = _mm_unpacklo_epi8(x[k], x[k + 8]);
+            y[2 * k + 1] = _mm_unpackhi_epi8(x[k], x[k + 8]);
+        }
+        memcpy(x, y, sizeof x);
+    }
+    for (int k = 0; k < 16; k++) {
+        _mm_storeu_si128((__m128i *)&dst[k * ldd], x[k]);
+    }
+}
+
+__attribute__((target("sse2")))
+static void tileSSE8x8w(const void *s, int lds, void *d, int ldd)
+{
+    const uint16_t *src = (const uint16_t *)s;
+    uint16_t *dst = (uint16_t *)d;
+    __m128i x[8], y[8];
+
+    for (int k = 0; k < 8; k++) {
+        x[k] = _mm_loadu_si128((const __m128i *)&src[k * lds]);
+    }
+    for (int round = 0; round < 3; round++) {
+        for (int k = 0; k < 4; k++) {
+            y[2 * k]     = _mm_unpacklo_epi16(x[k], x[k + 4]);
+            y[2 * k + 1] = _mm_unpackhi_epi16(x[k], x[k + 4]);
+        }
+        memcpy(x, y, sizeof x);
+    }
+    for (int k = 0; k < 8; k++) {
+        _mm_storeu_si128((__m128i *)&dst[k * ldd], x[k]);
+    }
+}
+
+/*****************************************************************************
+ * AVX2: 8x8 float tile (unpack -> shuffle -> 128-bit lane permute),
+ *       4x4 double tile (unpack -> 128-bit lane permute)
+ *****************************************************************************/
+
+__attribute__((target("avx2")))
+static void tileAVX8x8(const void *s, int lds, void *d, int ldd)
+{
+    const float *src = (const float *)s;
+    float *dst = (float *)d;
+
+    __m256 r0 = _mm256_loadu_ps(&src[0 * lds]);
+    __m256 r1 = _mm256_loadu_ps(&src[1 * lds]);
+    __m256 r2 = _mm256_loadu_ps(&src[2 * lds]);
+    __m256 r3 = _mm256_loadu_ps(&src[3 * lds]);
+    __m256 r4 = _mm256_loadu_ps(&src[4 * lds]);
+    __m256 r5 = _mm256_loadu_ps(&src[5 * lds]);
+    __m256 r6 = _mm256_loadu_ps(&src[6 * lds]);
+    __m256 r7 = _mm256_loadu_ps(&src[7 * lds]);
+
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+    __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+    __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+    __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+    __m256 s0 = _mm256_shuffle_ps(t0, t2, 0x44);
+    __m256 s1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+    __m256 s2 = _mm256_shuffle_ps(t1, t3, 0x44);
+    __m256 s3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+    __m256 s4 = _mm256_shuffle_ps(t4, t6, 0x44);
+    __m256 s5 = _mm256_shuffle_ps(t4, t6, 0xEE);
+    __m256 s6 = _mm256_shuffle_ps(t5, t7, 0x44);
+    __m256 s7 = _mm256_shuffle_ps(t5, t7, 0xEE);
+
+    _mm256_storeu_ps(&dst[0 * ldd], _mm256_permute2f128_ps(s0, s4, 0x20));
+    _mm256_storeu_ps(&dst[1 * ldd], _mm256_permute2f128_ps(s1, s5, 0x20));
+    _mm256_storeu_ps(&dst[2 * ldd], _mm256_permute2f128_ps(s2, s6, 0x20));
+    _mm256_storeu_ps(&dst[3 * ldd], _mm256_permute2f128_ps(s3, s7, 0x20));
+    _mm256_storeu_ps(&dst[4 * ldd], _mm256_permute2f128_ps(s0, s4, 0x31));
+    _mm256_storeu_ps(&dst[5 * ldd], _mm256_permute2f128_ps(s1, s5, 0x31));
+    _mm256_storeu_ps(&dst[6 * ldd], _mm256_permute2f128_ps(s2, s6, 0x31));
+    _mm256_storeu_ps(&dst[7 * ldd], _mm256_permute2f128_ps(s3, s7, 0x31));
+}
+
+__attribute__((target("avx2")))
+static void tileAVX4x4d(const void *s, int lds, void *d, int ldd)
+{
+    const double *src = (const double *)s;
+    double *dst = (double *)d;
+
+    __m256d r0 = _mm256_loadu_pd(&src[0 * lds]);
+    __m256d r1 = _mm256_loadu_pd(&src[1 * lds]);
+    __m256d r2 = _mm256_loadu_pd(&src[2 * lds]);
+    __m256d r3 = _mm256_loadu_pd(&src[3 * lds]);
+
+    __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+    __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+    __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+    __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+    _mm256_storeu_pd(&dst[0 * ldd], _mm256_permute2f128_pd(t0, t2, 0x20));
+    _mm256_storeu_pd(&dst[1 * ldd], _mm256_permute2f128_pd(t1, t3, 0x20));
+    _mm256_storeu_pd(&dst[2 * ldd], _mm256_permute2f128_pd(t0, t2, 0x31));
+    _mm256_storeu_pd(&dst[3 * ldd], _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+
+/*****************************************************************************
+ * AVX-512: 16x16 float tile (unpack -> shuffle -> two rounds of 128-bit lane
+ *          shuffles), 8x8 double tile (unpack -> two rounds of lane shuffles)
+ *****************************************************************************/
+
+__attribute__((target("avx512f")))
+static void tileAVX512x16(const void *s, int lds, void *d, int ldd)
+{
+    const float *src = (const float *)s;
+    float *dst = (float *)d;
+    __m512 r[16], t[16];
+
+    for (int k = 0; k < 16; k++) {
+        r[k] = _mm512_loadu_ps(&src[k * lds]);
+    }
+
+    // interleave pairs of rows
+    for (int k = 0; k < 16; k += 2) {
+        t[k]     = _mm512_unpacklo_ps(r[k], r[k + 1]);
+        t[k + 1] = _mm512_unpackhi_ps(r[k], r[k + 1]);
+    }
+
+    // 4x4 transposes inside every 128-bit lane
+    for (int k = 0; k < 16; k += 4) {
+        r[k]     = _mm512_shuffle_ps(t[k],     t[k + 2], 0x44);
+        r[k + 1] = _mm512_shuffle_ps(t[k],     t[k + 2], 0xEE);
+        r[k + 2] = _mm512_shuffle_ps(t[k + 1], t[k + 3], 0x44);
+        r[k + 3] = _mm512_shuffle_ps(t[k + 1], t[k + 3], 0xEE);
+    }
+
+    // move 128-bit lanes across rows (two rounds)
+    for (int k = 0; k < 4; k++) {
+        t[k]      = _mm512_shuffle_f32x4(r[k],     r[k + 4],  0x88);
+        t[k + 4]  = _mm512_shuffle_f32x4(r[k],     r[k + 4],  0xDD);
+        t[k + 8]  = _mm512_shuffle_f32x4(r[k + 8], r[k + 12], 0x88);
+        t[k + 12] = _mm512_shuffle_f32x4(r[k + 8], r[k + 12], 0xDD);
+    }
+    for (int k = 0; k < 8; k++) {
+        r[k]     = _mm512_shuffle_f32x4(t[k], t[k + 8], 0x88);
+        r[k + 8] = _mm512_shuffle_f32x4(t[k], t[k + 8], 0xDD);
+    }
+
+    for (int k = 0; k < 16; k++) {
+        _mm512_storeu_ps(&dst[k * ldd], r[k]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void tileAVX512x8d(const void *s, int lds, void *d, int ldd)
+{
+    const double *src = (const double *)s;
+    double *dst = (double *)d;
+    __m512d r[8], t[8];
+
+    for (int k = 0; k < 8; k++) {
+        r[k] = _mm512_loadu_pd(&src[k * lds]);
+    }
+
+    // 2x2 transposes inside every 128-bit lane: lane L of t[2k + p] holds
+    // column 2L + p of rows 2k, 2k + 1
+    for (int k = 0; k < 8; k += 2) {
+        t[k]     = _mm512_unpacklo_pd(r[k], r[k + 1]);
+        t[k + 1] = _mm512_unpackhi_pd(r[k], r[k + 1]);
+    }
+
+    // output row 2L + p collects lane L of t[p], t[2 + p], t[4 + p], t[6 + p]
+    for (int p = 0; p < 2; p++) {
+        __m512d u0 = _mm512_shuffle_f64x2(t[p],     t[2 + p], 0x88);
+        __m512d u1 = _mm512_shuffle_f64x2(t[p],     t[2 + p], 0xDD);
+        __m512d u2 = _mm512_shuffle_f64x2(t[4 + p], t[6 + p], 0x88);
+        __m512d u3 = _mm512_shuffle_f64x2(t[4 + p], t[6 + p], 0xDD);
+        r[0 + p] = _mm512_shuffle_f64x2(u0, u2, 0x88);
+        r[4 + p] = _mm512_shuffle_f64x2(u0, u2, 0xDD);
+        r[2 + p] = _mm512_shuffle_f64x2(u1, u3, 0x88);
+        r[6 + p] = _mm512_shuffle_f64x2(u1, u3, 0xDD);
+    }
+
+    for (int k = 0; k < 8; k++) {
+        _mm512_storeu_pd(&dst[k * ldd], r[k]);
+    }
+}
+
+/*****************************************************************************
+ * Row comparison (symmetry checks)
+ *****************************************************************************/
+
+__attribute__((target("sse")))
+static int equalSSE(const float *a, const float *b, int n)
+{
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        if (_mm_movemask_ps(_mm_cmpneq_ps(_mm_loadu_ps(&a[k]), _mm_loadu_ps(&b[k])))) return 0;
+    }
+    return equalScalar(&a[k], &b[k], n - k);
+}
+
+__attribute__((target("avx2")))
+static int equalAVX(const float *a, const float *b, int n)
+{
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256 ne = _mm256_cmp_ps(_mm256_loadu_ps(&a[k]), _mm256_loadu_ps(&b[k]), _CMP_NEQ_UQ);
+        if (_mm256_movemask_ps(ne)) return 0;
+    }
+    return equalScalar(&a[k], &b[k], n - k);
+}
+
+__attribute__((target("avx512f")))
+static int equalAVX512(const float *a, const float *b, int n)
+{
+    int k = 0;
+    for (; k + 16 <= n; k += 16) {
+        if (_mm512_cmp_ps_mask(_mm512_loadu_ps(&a[k]), _mm512_loadu_ps(&b[k]), _CMP_NEQ_UQ)) return 0;
+    }
+    return equalScalar(&a[k], &b[k], n - k);
+}
+
+#endif // HAVE_X86_KERNELS
+
+/*****************************************************************************
+ * Dispatch
+ *****************************************************************************/
+
+typedef struct {
+    TileKernel kernel;
+    int        width;   // tile edge in elements
+} RegisterTile;
+
+typedef struct {
+    const char  *name;
+    const char  *cpuFeature;   // NULL: always available
+    RegisterTile tiles[4];     // 1-, 2-, 4- and 8-byte elements
+    EqualKernel  equal;
+} KernelEntry;
+
+// Narrowest first; initTransposeKernels picks the last supported entry.
+static const KernelEntry kernelTable[] = {
+    { "scalar", NULL,      { { tileScalar4x4x8, 4 },  { tileScalar4x4x16, 4 },
+                             { tileScalar4x4, 4 },    { tileScalar4x4x64, 4 } }, equalScalar },
+#ifdef HAVE_X86_KERNELS
+    { "sse",    "sse2",    { { tileSSE16x16b, 16 },   { tileSSE8x8w, 8 },
+                             { tileSSE4x4, 4 },       { tileSSE2x2d, 2 } },      equalSSE    },
+    { "avx2",   "avx2",    { { tileSSE16x16b, 16 },   { tileSSE8x8w, 8 },
+                             { tileAVX8x8, 8 },       { tileAVX4x4d, 4 } },      equalAVX    },
+    { "avx512", "avx512f", { { tileSSE16x16b, 16 },   { tileSSE8x8w, 8 },
+                             { tileAVX512x16, 16 },   { tileAVX512x8d, 8 } },    equalAVX512 },
+#endif
+};
+static const int kernelCount = sizeof(kernelTable) / sizeof(kernelTable[0]);
+
+static const KernelEntry *kernelEntry = &kernelTable[0];
+static TileKernel  tileKernel  = tileScalar4x4;
+static int         tileWidth   = 4;
+static EqualKernel equalKernel = equalScalar;
+
+static int kernelSupported(const KernelEntry *e)
+{
+    if (e->cpuFeature == NULL) {
+        return 1;
+    }
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    // __builtin_cpu_supports needs a string literal
+    if (strcmp(e->cpuFeature, "sse2") == 0)    return __builtin_cpu_supports("sse2");
+    if (strcmp(e->cpuFeature, "avx2") == 0)    return __builtin_cpu_supports("avx2");
+    if (strcmp(e->cpuFeature, "avx512f") == 0) return __builtin_cpu_supports("avx512f");
+#endif
+    return 0;
+}
+
+// The register tile of the selected kernel for the selected element width
+static void selectTile(void)
+{
+    int slot = (elemBytes == 1) ? 0 : (elemBytes == 2) ? 1 : (elemBytes == 4) ? 2 : 3;
+    tileKernel = kernelEntry->tiles[slot].kernel;
+    tileWidth  = kernelEntry->tiles[slot].width;
+}
+
+static void useKernel(const KernelEntry *e)
+{
+    kernelEntry = e;
+    equalKernel = e->equal;
+    selectTile();
+}
+
+void initTransposeKernels(void)
+{
+    for (int k = 0; k < kernelCount; k++) {
+        if (kernelSupported(&kernelTable[k])) {
+            useKernel(&kernelTable[k]);
+        }
+    }
+}
+
+const char *transposeKernelName(void)
+{
+    return kernelEntry->name;
+}
+
+int transposeKernelNames(const char **names, int maxNames)
+{
+    int count = 0;
+    for (int k = 0; k < kernelCount && count < maxNames; k++) {
+        if (kernelSupported(&kernelTable[k])) {
+            names[count++] = kernelTable[k].name;
+        }
+    }
+    return count;
+}
+
+int setTransposeKernel(const char *name)
+{
+    for (int k = 0; k < kernelCount; k++) {
+        if (strcmp(kernelTable[k].name, name) == 0 && kernelSupported(&kernelTable[k])) {
+            useKernel(&kernelTable[k]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int setElementType(const char *name)
+{
+    for (int t = 0; t < ELEM_TYPE_COUNT; t++) {
+        if (strcmp(elemTypes[t].name, name) == 0) {
+            elemType  = (ElemType)t;
+            elemBytes = elemTypes[t].bytes;
+            selectTile();
+            return 1;
+        }
+    }
+    return 0;
+}
+
+ElemType elementType(void)
+{
+    return elemType;
+}
+
+const char *elementTypeName(ElemType type)
+{
+    return (type >= 0 && type < ELEM_TYPE_COUNT) ? elemTypes[type].name : "unknown";
+}
+
+size_t elementBytes(void)
+{
+    return elemBytes;
+}
+
+int elementsEqual(const void *a, const void *b, int n)
+{
+    switch (elemType) {
+    case ELEM_FLOAT:
+        return equalKernel((const float *)a, (const float *)b, n);
+    case ELEM_C64:
+        // real and imaginary parts side by side
+        return equalKernel((const float *)a, (const float *)b, 2 * n);
+    case ELEM_DOUBLE: {
+        const double *x = (const double *)a, *y = (const double *)b;
+        for (int k = 0; k < n; k++) {
+            if (x[k] != y[k]) return 0;
+        }
+        return 1;
+    }
+    default:
+        return memcmp(a, b, (size_t)n * elemBytes) == 0;
+    }
+}
+
+// Elements of the mirrored column gathered per elementsEqual call
+#define MIRROR_RUN 64
+
+int mirrorEqual(const void *a, int ld, int i, int j0, int j1)
+{
+    size_t es = elemBytes;
+    const char *p = (const char *)a;
+    char column[MIRROR_RUN * 8];
+
+    for (int j = j0; j < j1; j += MIRROR_RUN) {
+        int run = (j1 - j < MIRROR_RUN) ? j1 - j : MIRROR_RUN;
+        for (int k = 0; k < run; k++) {
+            copyElement(&column[k * es], p + ((size_t)(j + k) * ld + i) * es, es);
+        }
+        if (!elementsEqual(p + ((size_t)i * ld + j) * es, column, run)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void transposeTile(const void *src, int lds, void *dst, int ldd, int rows, int cols)
+{
+    TileKernel kernel = tileKernel;
+    int w = tileWidth;
+    size_t es = elemBytes;
+    const char *s = (const char *)src;
+    char *d = (char *)dst;
+    int rFull = rows - rows % w;
+    int cFull = cols - cols % w;
+
+    for (int r = 0; r < rFull; r += w) {
+        for (int c = 0; c < cFull; c += w) {
+            kernel(s + ((size_t)r * lds + c) * es, lds, d + ((size_t)c * ldd + r) * es, ldd);
+        }
+        // leftover columns of this row strip
+        for (int i = r; i < r + w; i++) {
+            for (int c = cFull; c < cols; c++) {
+                copyElement(d + ((size_t)c * ldd + i) * es, s + ((size_t)i * lds + c) * es, es);
+            }
+        }
+    }
+    // leftover rows
+    for (int i = rFull; i < rows; i++) {
+        for (int c = 0; c < cols; c++) {
+            copyElement(d + ((size_t)c * ldd + i) * es, s + ((size_t)i * lds + c) * es, es);
+        }
+    }
+}
+
+void transposeBlocked(const void *src, int lds, void *dst, int ldd,
+                      int rows, int cols, int blockSize)
+{
+    size_t es = elemBytes;
+    for (int ii = 0; ii < rows; ii += blockSize) {
+        for (int jj = 0; jj < cols; jj += blockSize) {
+            int imax = (ii + blockSize > rows) ? rows : (ii + blockSize);
+            int jmax = (jj + blockSize > cols) ? cols : (jj + blockSize);
+
+            transposeTile((const char *)src + ((size_t)ii * lds + jj) * es, lds,
+                          (char *)dst + ((size_t)jj * ldd + ii) * es, ldd,
+                          imax - ii, jmax - jj);
+        }
+    }
+}
+
+// Largest register tile in bytes (16 x 16 floats)
+#define TILE_BYTES_MAX (16 * 16 * 4)
+
+void transposeSwapTiles(void *a, void *b, int ld, int rows, int cols)
+{
+    TileKernel kernel = tileKernel;
+    int w = tileWidth;
+    size_t es = elemBytes;
+    char *pa = (char *)a, *pb = (char *)b;
+    int rFull = rows - rows % w;
+    int cFull = cols - cols % w;
+    char tmp[TILE_BYTES_MAX] __attribute__((aligned(64)));
+
+    // full register tiles: a -> tmp, b^T -> a, tmp -> b
+    for (int r = 0; r < rFull; r += w) {
+        for (int c = 0; c < cFull; c += w) {
+            char *aTile = pa + ((size_t)r * ld + c) * es;
+            char *bTile = pb + ((size_t)c * ld + r) * es;
+
+            kernel(aTile, ld, tmp, w);
+            kernel(bTile, ld, aTile, ld);
+            for (int k = 0; k < w; k++) {
+                memcpy(bTile + (size_t)k * ld * es, &tmp[k * w * es], w * es);
+            }
+        }
+    }
+
+    // ragged edges: element-wise swaps
+    for (int i = 0; i < rows; i++) {
+        int jStart = (i < rFull) ? cFull : 0;
+        for (int j = jStart; j < cols; j++) {
+            swapElements(pa + ((size_t)i * ld + j) * es, pb + ((size_t)j * ld + i) * es, es);
+        }
+    }
+}
+
+/**
+ * Transposes a single n x n tile in place: diagonal register tiles go
+ * through tmp, off-diagonal register tiles are swapped pairwise.
+ */
+static void transposeTileInPlace(void *a, int ld, int n)
+{
+    TileKernel kernel = tileKernel;
+    int w = tileWidth;
+    size_t es = elemBytes;
+    char *p = (char *)a;
+    int nFull = n - n % w;
+    char tmp[TILE_BYTES_MAX] __attribute__((aligned(64)));
+
+    for (int r = 0; r < nFull; r += w) {
+        char *diag = p + ((size_t)r * ld + r) * es;
+        kernel(diag, ld, tmp, w);
+        for (int k = 0; k < w; k++) {
+            memcpy(diag + (size_t)k * ld * es, &tmp[k * w * es], w * es);
+        }
+        if (r + w < nFull) {
+            transposeSwapTiles(p + ((size_t)r * ld + (r + w)) * es,
+                               p + ((size_t)(r + w) * ld + r) * es,
+                               ld, w, nFull - (r + w));
+        }
+    }
+
+    // pairs (i,j) whose larger index lies in the ragged edge
+    for (int i = 0; i < n; i++) {
+        int jStart = (i + 1 > nFull) ? i + 1 : nFull;
+        for (int j = jStart; j < n; j++) {
+            swapElements(p + ((size_t)i * ld + j) * es, p + ((size_t)j * ld + i) * es, es);
+        }
+    }
+}
+
+void transposeBlockedInPlace(void *a, int ld, int n, int blockSize)
+{
+    size_t es = elemBytes;
+    char *p = (char *)a;
+    for (int ii = 0; ii < n; ii += blockSize) {
+        int imax = (ii + blockSize > n) ? n : (ii + blockSize);
+
+        transposeTileInPlace(p + ((size_t)ii * ld + ii) * es, ld, imax - ii);
+
+        for (int jj = imax; jj < n; jj += blockSize) {
+            int jmax = (jj + blockSize > n) ? n : (jj + blockSize);
+            transposeSwapTiles(p + ((size_t)ii * ld + jj) * es, p + ((size_t)jj * ld + ii) * es,
+                               ld, imax - ii, jmax - jj);
+        }
+    }
+}
+
+/*****************************************************************************
+ * Streaming (non-temporal) stores for outputs larger than the LLC
+ *****************************************************************************/
+
+#define STREAM_FALLBACK_LLC ((size_t)32 << 20)
+// Staging tile: up to STREAM_STAGE_ROWS output rows of STREAM_STAGE_BYTES
+// bytes, i.e. four whole 64-byte lines per output row whatever the type.
+#define STREAM_STAGE_ROWS  16
+#define STREAM_STAGE_BYTES 256
+
+static size_t llcBytes = 0;
+static int    streamMode = -1;  // -1: automatic, 0: off, 1: on
+
+// "32768K" / "32M" style sizes from /sys
+static size_t parseCacheSize(const char *text)
+{
+    char unit = '\0';
+    unsigned long value = 0;
+    if (sscanf(text, "%lu%c", &value, &unit) < 1) {
+        return 0;
+    }
+    if (unit == 'K' || unit == 'k') return (size_t)value << 10;
+    if (unit == 'M' || unit == 'm') return (size_t)value << 20;
+    return (size_t)value;
+}
+
+size_t lastLevelCacheBytes(void)
+{
+    if (llcBytes != 0) {
+        return llcBytes;
+    }
+
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (l3 > 0) llcBytes = (size_t)l3;
+#endif
+
+    // otherwise the largest cache sysfs reports for cpu0
+    size_t largest = 0;
+    for (int idx = 0; llcBytes == 0 && idx < 8; idx++) {
+        char path[64], text[32];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", idx);
+        FILE *f = fopen(path, "r");
+        if (!f) break;
+        if (fgets(text, sizeof(text), f)) {
+            size_t size = parseCacheSize(text);
+            if (size > largest) largest = size;
+        }
+        fclose(f);
+    }
+    if (llcBytes == 0) {
+        llcBytes = largest;
+    }
+
+    if (llcBytes == 0) {
+        llcBytes = STREAM_FALLBACK_LLC;
+    }
+    return llcBytes;
+}
+
+int useStreamingStores(size_t outputBytes)
+{
+    if (streamMode < 0) {
+        const char *env = getenv("MATTRANSPOSE_STREAM");
+        streamMode = (env && (*env == '0' || *env == '1')) ? (*env - '0') : 2;
+    }
+    if (streamMode != 2) {
+        return streamMode;
+    }
+    return outputBytes > lastLevelCacheBytes();
+}
+
+// Copies n bytes from the staging tile to dst. Whole 64-byte lines are
+// written with non-temporal stores; a partial line at either end goes
+// through the cache, since streaming it would split a write-combining buffer.
+#ifdef HAVE_X86_KERNELS
+__attribute__((target("sse2")))
+static void streamRow(char *dst, const char *stage, size_t n)
+{
+    size_t k = 0;
+    for (; k < n && ((uintptr_t)&dst[k] & 63) != 0; k++) {
+        dst[k] = stage[k];
+    }
+    for (; k + 64 <= n; k += 64) {
+        _mm_stream_si128((__m128i *)&dst[k],      _mm_loadu_si128((const __m128i *)&stage[k]));
+        _mm_stream_si128((__m128i *)&dst[k + 16], _mm_loadu_si128((const __m128i *)&stage[k + 16]));
+        _mm_stream_si128((__m128i *)&dst[k + 32], _mm_loadu_si128((const __m128i *)&stage[k + 32]));
+        _mm_stream_si128((__m128i *)&dst[k + 48], _mm_loadu_si128((const __m128i *)&stage[k + 48]));
+    }
+    memcpy(&dst[k], &stage[k], n - k);
+}
+#else
+static void streamRow(char *dst, const char *stage, size_t n)
+{
+    memcpy(dst, stage, n);
+}
+#endif
+
+void transposeTileStream(const void *src, int lds, void *dst, int ldd, int rows, int cols)
+{
+    char stage[STREAM_STAGE_ROWS * STREAM_STAGE_BYTES] __attribute__((aligned(64)));
+    size_t es = elemBytes;
+    int stageCols = (int)(STREAM_STAGE_BYTES / es);
+
+    for (int c0 = 0; c0 < cols; c0 += STREAM_STAGE_ROWS) {
+        int cw = (c0 + STREAM_STAGE_ROWS > cols) ? cols - c0 : STREAM_STAGE_ROWS;
+
+        for (int r0 = 0; r0 < rows; r0 += stageCols) {
+            int rw = (r0 + stageCols > rows) ? rows - r0 : stageCols;
+
+            // transpose into the L1-resident stage, then write whole lines out
+            transposeTile((const char *)src + ((size_t)r0 * lds + c0) * es, lds,
+                          stage, stageCols, rw, cw);
+            for (int c = 0; c < cw; c++) {
+                streamRow((char *)dst + ((size_t)(c0 + c) * ldd + r0) * es,
+                          &stage[c * STREAM_STAGE_BYTES], rw * es);
+            }
+        }
+    }
+}
+
+void streamFence(void)
+{
+#ifdef HAVE_X86_KERNELS
+    _mm_sfence();
+#endif
+}
+
+/*****************************************************************************
+ * Cycle-following permutation of a P x Q grid of L-element segments
+ *****************************************************************************/
+
+void transposeSegmentsInPlace(void *a, long P, long Q, long L)
+{
+    long N = P * Q;
+    if (P <= 1 || Q <= 1) {
+        return;  // a 1 x Q or P x 1 grid is its own transpose
+    }
+
+    char *p = (char *)a;
+    size_t bytes = (size_t)L * elemBytes;
+
+    // one bit per segment: set once the segment has reached its final slot
+    uint8_t *done = (uint8_t *)calloc((N + 7) / 8, 1);
+    char *carry   = (char *)malloc(2 * bytes);
+    if (!done || !carry) {
+        fprintf(stderr, "transposeSegmentsInPlace: Could not allocate the cycle buffers\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    char *swap    = carry + bytes;
+
+    // segment k = i*Q + j moves to j*P + i = k*P mod (N-1); 0 and N-1 stay put
+    for (long s = 1; s < N - 1; s++) {
+        if (done[s >> 3] & (1u << (s & 7))) {
+            continue;
+        }
+
+        memcpy(carry, &p[s * bytes], bytes);
+        long k = s;
+        do {
+            long d = (long)(((uint64_t)k * (uint64_t)P) % (uint64_t)(N - 1));
+            memcpy(swap, &p[d * bytes], bytes);
+            memcpy(&p[d * bytes], carry, bytes);
+            memcpy(carry, swap, bytes);
+            done[d >> 3] |= (uint8_t)(1u << (d & 7));
+            k = d;
+        } while (k != s);
+    }
+
+    free(carry);
+    free(done);
+}
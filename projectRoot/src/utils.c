@@ -1,28 +1,112 @@
+#include <stdint.h>
+#include <string.h>
 #include "utils.h"
+#include "matrix_io.h"     // ORDER_*
+#include "simd_kernels.h"
 
-void initializeMatrix(float *matrix, int n, int seed) {
-    srand(seed > 0 ? seed : 1234);
-    for (int i = 0; i < n * n; i++) {
-        matrix[i] = (float)rand() / (float)(RAND_MAX / 100.0f);
+/*
+ Counter-based generator: element (i,j) is a pure function of (seed, i, j)
+ (two SplitMix64 rounds), so any rank or thread can produce any part of the
+ matrix on its own and the values never depend on the decomposition.
+ */
+static uint64_t splitMix64(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t elementKey(int seed, long i, long j)
+{
+    uint64_t key = ((uint64_t)i << 32) | (uint32_t)j;
+    return splitMix64(splitMix64((uint64_t)(seed > 0 ? seed : 1234)) ^ key);
+}
+
+/*
+ Element (i,j) in the selected type, from its 64-bit key: floats are exact
+ in [0, 100) from the top 24 bits, doubles from the top 53 bits, integers
+ from the top bits of their width, complex values with a second 24-bit
+ draw as the imaginary part.
+ */
+static void storeValue(void *dst, int seed, long i, long j)
+{
+    uint64_t h = elementKey(seed, i, j);
+    switch (elementType()) {
+    case ELEM_DOUBLE: { double v  = (double)(h >> 11) * (100.0 / 9007199254740992.0);
+                        memcpy(dst, &v, sizeof v); break; }
+    case ELEM_I8:     { int8_t v  = (int8_t)(h >> 56);  memcpy(dst, &v, sizeof v); break; }
+    case ELEM_I16:    { int16_t v = (int16_t)(h >> 48); memcpy(dst, &v, sizeof v); break; }
+    case ELEM_I32:    { int32_t v = (int32_t)(h >> 32); memcpy(dst, &v, sizeof v); break; }
+    case ELEM_C64:    { float v[2] = { (float)(h >> 40) * (100.0f / 16777216.0f),
+                                       (float)((h >> 16) & 0xFFFFFF) * (100.0f / 16777216.0f) };
+                        memcpy(dst, v, sizeof v); break; }
+    default:          { float v = (float)(h >> 40) * (100.0f / 16777216.0f);
+                        memcpy(dst, &v, sizeof v); break; }
+    }
+}
+
+/*
+ Element as a float for printing and the partial checksums; complex values
+ count as re + 2 im, so swapped parts change the checksum.
+ */
+static float elementAsFloat(const void *src)
+{
+    switch (elementType()) {
+    case ELEM_DOUBLE: { double v;  memcpy(&v, src, sizeof v); return (float)v; }
+    case ELEM_I8:     { int8_t v;  memcpy(&v, src, sizeof v); return (float)v; }
+    case ELEM_I16:    { int16_t v; memcpy(&v, src, sizeof v); return (float)v; }
+    case ELEM_I32:    { int32_t v; memcpy(&v, src, sizeof v); return (float)v; }
+    case ELEM_C64:    { float v[2]; memcpy(v, src, sizeof v); return v[0] + 2.0f * v[1]; }
+    default:          { float v;   memcpy(&v, src, sizeof v); return v; }
     }
 }
 
-void initializeSymmetricMatrix(float *matrix, int n, int seed) {
-    srand(seed);
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j <= i; j++) {
-            float value = (float)rand() / (float)(RAND_MAX / 100.0f);
-            matrix[i * n + j] = value;  // Fill lower triangle
-            matrix[j * n + i] = value;  // Mirror to upper triangle
+void initializeMatrix(void *matrix, int n, int seed) {
+    initializeMatrixRect(matrix, n, n, seed);
+}
+
+void initializeMatrixRect(void *matrix, int rows, int cols, int seed) {
+    initializeMatrixBlock(matrix, cols, 0, 0, rows, cols, seed, 0);
+}
+
+void initializeSymmetricMatrix(void *matrix, int n, int seed) {
+    initializeMatrixBlock(matrix, n, 0, 0, n, n, seed, 1);
+}
+
+void initializeMatrixBlock(void *block, int ld, int rowOffset, int colOffset,
+                           int rows, int cols, int seed, int symmetric) {
+    size_t es = elementBytes();
+#pragma omp parallel for default(none) shared(block, ld, rowOffset, colOffset, rows, cols, seed, symmetric, es)
+    for (int r = 0; r < rows; r++) {
+        char *row = (char *)block + (size_t)r * ld * es;
+        long i = (long)rowOffset + r;
+        for (int c = 0; c < cols; c++) {
+            long j = (long)colOffset + c;
+            if (symmetric && i > j) storeValue(&row[c * es], seed, j, i);
+            else                    storeValue(&row[c * es], seed, i, j);
         }
     }
 }
 
 
-void printMatrix(const float *matrix, int n) {
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            printf("%8.2f ", matrix[i * n + j]);
+void printMatrix(const void *matrix, int n) {
+    printMatrixRect(matrix, n, n);
+}
+
+void printMatrixRect(const void *matrix, int rows, int cols) {
+    ElemType type = elementType();
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            const void *e = ELEM(matrix, (size_t)i * cols + j);
+            if (type == ELEM_C64) {
+                const float *z = (const float *)e;
+                printf("%8.2f%+8.2fi ", z[0], z[1]);
+            } else if (type == ELEM_I8 || type == ELEM_I16 || type == ELEM_I32) {
+                printf("%8.0f ", elementAsFloat(e));
+            } else {
+                printf("%8.2f ", elementAsFloat(e));
+            }
         }
         printf("\n");
     }
@@ -51,24 +135,66 @@ double getWallTime() {
  * @param n      Matrix dimension
  * @return       A partial weighted checksum
  */
-float partialChecksum(const float *matrix, int n)
+float partialChecksum(const void *matrix, int n)
+{
+    return partialChecksumRect(matrix, n, n);
+}
+
+// Element accessors for partialChecksumOf
+typedef struct {
+    const void *matrix; FILE *file; long offset; int rows, cols; int seed; int symmetric;
+    int order, tileSize;     // file payload layout
+} ChecksumSource;
+
+static float storedElement(const ChecksumSource *src, int i, int j)
+{
+    return elementAsFloat(ELEM(src->matrix, (size_t)i * src->cols + j));
+}
+
+static float generatedElement(const ChecksumSource *src, int i, int j)
+{
+    char value[8];
+    if (src->symmetric && i > j) storeValue(value, src->seed, j, i);
+    else                         storeValue(value, src->seed, i, j);
+    return elementAsFloat(value);
+}
+
+static float fileElement(const ChecksumSource *src, int i, int j)
+{
+    long es = (long)elementBytes();
+    long pos = (long)i * src->cols + j;
+    if (src->order == ORDER_COL_MAJOR) {
+        pos = (long)j * src->rows + i;
+    } else if (src->order == ORDER_TILED) {
+        long ts = src->tileSize, tilesJ = (src->cols + ts - 1) / ts;
+        pos = ((i / ts) * tilesJ + j / ts) * ts * ts + (i % ts) * ts + j % ts;
+    }
+    char value[8] = { 0 };
+    if (fseek(src->file, src->offset + pos * es, SEEK_SET) != 0
+        || fread(value, (size_t)es, 1, src->file) != 1) {
+        fprintf(stderr, "partialChecksumFile: short read at (%d, %d)\n", i, j);
+    }
+    return elementAsFloat(value);
+}
+
+static float partialChecksumOf(float (*at)(const ChecksumSource *, int, int),
+                               const ChecksumSource *src, int rows, int cols)
 {
     float sum = 0.0f;
-    if (n <= 0) return sum;  // Edge case: no size
+    if (rows <= 0 || cols <= 0) return sum;  // Edge case: no size
 
     // Identify up to 3 selected rows/columns
-    int mid = n / 2;
-    int selectedRows[3] = {0, mid, n - 1};
-    int selectedCols[3] = {0, mid, n - 1};
+    int selectedRows[3] = {0, rows / 2, rows - 1};
+    int selectedCols[3] = {0, cols / 2, cols - 1};
 
     // 1) Sum the selected rows, weighting by (i+1)
     for (int r = 0; r < 3; r++) {
         int i = selectedRows[r];
         // Validate index in range
-        if (i >= 0 && i < n) {
+        if (i >= 0 && i < rows) {
             float rowWeight = (float)(i + 1);
-            for (int j = 0; j < n; j++) {
-                sum += rowWeight * matrix[i * n + j];
+            for (int j = 0; j < cols; j++) {
+                sum += rowWeight * at(src, i, j);
             }
         }
     }
@@ -77,13 +203,54 @@ float partialChecksum(const float *matrix, int n)
     for (int c = 0; c < 3; c++) {
         int j = selectedCols[c];
         // Validate index in range
-        if (j >= 0 && j < n) {
+        if (j >= 0 && j < cols) {
             float colWeight = (float)(j + 1);
-            for (int i = 0; i < n; i++) {
-                sum += colWeight * matrix[i * n + j];
+            for (int i = 0; i < rows; i++) {
+                sum += colWeight * at(src, i, j);
             }
         }
     }
 
     return sum;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief rows x cols version of partialChecksum. Rows are picked from
+ *        {0, rows/2, rows-1} and columns from {0, cols/2, cols-1}, so a
+ *        matrix and its cols x rows transpose give the same checksum.
+ */
+float partialChecksumRect(const void *matrix, int rows, int cols)
+{
+    ChecksumSource src = { matrix, NULL, 0, rows, cols, 0, 0, ORDER_ROW_MAJOR, 0 };
+    return partialChecksumOf(storedElement, &src, rows, cols);
+}
+
+/**
+ * @brief partialChecksumRect of the matrix initializeMatrixBlock would
+ *        generate, computed from the generator alone (O(rows + cols)), so
+ *        no rank needs to hold the whole matrix.
+ */
+float partialChecksumGenerated(int rows, int cols, int seed, int symmetric)
+{
+    ChecksumSource src = { NULL, NULL, 0, rows, cols, seed, symmetric, ORDER_ROW_MAJOR, 0 };
+    return partialChecksumOf(generatedElement, &src, rows, cols);
+}
+
+/**
+ * @brief partialChecksumRect of a file whose payload starts at 'offset'
+ *        (--input, --output), laid out by 'order' (ORDER_*, tiles of
+ *        tileSize), reading only the 3 rows and 3 columns it needs.
+ */
+float partialChecksumFile(const char *path, long offset, int rows, int cols,
+                          int order, int tileSize)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "partialChecksumFile: cannot open '%s'\n", path);
+        return 0.0f;
+    }
+    ChecksumSource src = { NULL, file, offset, rows, cols, 0, 0, order, tileSize };
+    float sum = partialChecksumOf(fileElement, &src, rows, cols);
+    fclose(file);
+    return sum;
+}